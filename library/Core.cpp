@@ -47,7 +47,9 @@ using namespace std;
 #include "modules/EventManager.h"
 #include "modules/Gui.h"
 #include "modules/World.h"
+#include "modules/Translation.h"
 #include "modules/Graphic.h"
+#include "modules/Snapshot.h"
 #include "RemoteServer.h"
 #include "LuaTools.h"
 
@@ -1341,6 +1343,8 @@ void Core::doUpdate(color_ostream &out, bool first_update)
         last_local_map_ptr = new_mapdata;
 
         World::ClearPersistentCache();
+        Translation::ClearCache();
+        Snapshot::Clear();
 
         // and if the world is going away, we report the map change first
         if(had_map)
@@ -1363,6 +1367,9 @@ void Core::doUpdate(color_ostream &out, bool first_update)
         }
     }
 
+    // DF has processed input since the last frame
+    Gui::InvalidateFocusCache();
+
     // detect if the viewscreen changed
     if (df::global::gview) 
     {
@@ -1466,6 +1473,12 @@ void Core::onUpdate(color_ostream &out)
 
     // process timers in lua
     Lua::Core::onUpdate(out);
+
+    // store tile mask changes made during this frame
+    World::SyncPersistentTilemasks();
+
+    // publish a copy of the world for readers on other threads
+    Snapshot::Publish();
 }
 
 static void handleLoadAndUnloadScripts(Core* core, color_ostream& out, state_change_event event) {
@@ -1574,12 +1587,21 @@ bool Core::SelectHotkey(int sym, int modifiers)
 
         // Check the internal keybindings
         std::vector<KeyBinding> &bindings = key_bindings[sym];
+        std::string focus;
+        bool has_focus = false;
         for (int i = bindings.size()-1; i >= 0; --i) {
             if (bindings[i].modifiers != modifiers)
                 continue;
-            if (!bindings[i].focus.empty() &&
-                !prefix_matches(bindings[i].focus, Gui::getFocusString(screen)))
-                continue;
+            if (!bindings[i].focus.empty())
+            {
+                if (!has_focus)
+                {
+                    focus = Gui::getFocusString(screen);
+                    has_focus = true;
+                }
+                if (!prefix_matches(bindings[i].focus, focus))
+                    continue;
+            }
             if (!plug_mgr->CanInvokeHotkey(bindings[i].command[0], screen))
                 continue;
             cmd = bindings[i].cmdline;
@@ -27,6 +27,8 @@ distribution.
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <climits>
 
 #include "MemAccess.h"
 #include "Core.h"
@@ -52,6 +54,7 @@ distribution.
 #include "modules/Buildings.h"
 #include "modules/Random.h"
 #include "modules/Filesystem.h"
+#include "modules/Snapshot.h"
 
 #include "LuaWrapper.h"
 #include "LuaTools.h"
@@ -1490,6 +1493,210 @@ static int maps_getRegionBiome(lua_State *L)
     return 1;
 }
 
+/*
+ * Bulk map query: walks a box block by block and returns packed
+ * arrays of the requested tile data for tiles passing the filter.
+ */
+
+enum MapScanField {
+    SCAN_TILETYPE = 1,
+    SCAN_DESIGNATION = 2,
+    SCAN_OCCUPANCY = 4
+};
+
+struct MapScanFilter {
+    bool has_shape, has_material, has_hidden, hidden;
+    int min_flow, max_flow;
+    std::vector<bool> shapes, materials;
+
+    MapScanFilter()
+        : has_shape(false), has_material(false), has_hidden(false), hidden(false),
+          min_flow(0), max_flow(7) {}
+
+    bool matches(df::tiletype tt, df::tile_designation des) const
+    {
+        if (has_shape)
+        {
+            int shape = tileShape(tt) - ENUM_FIRST_ITEM(tiletype_shape);
+            if (shape < 0 || shape >= (int)shapes.size() || !shapes[shape])
+                return false;
+        }
+        if (has_material)
+        {
+            int mat = tileMaterial(tt) - ENUM_FIRST_ITEM(tiletype_material);
+            if (mat < 0 || mat >= (int)materials.size() || !materials[mat])
+                return false;
+        }
+        if (has_hidden && bool(des.bits.hidden) != hidden)
+            return false;
+        int flow = des.bits.flow_size;
+        return flow >= min_flow && flow <= max_flow;
+    }
+};
+
+static void check_scan_set(lua_State *L, int idx, const char *name,
+                           std::vector<bool> *set, bool *has, int first, int last)
+{
+    lua_getfield(L, idx, name);
+    if (!lua_isnil(L, -1))
+    {
+        *has = true;
+        set->assign(last - first + 1, false);
+
+        int cnt = lua_istable(L, -1) ? lua_rawlen(L, -1) : 1;
+        for (int i = 1; i <= cnt; i++)
+        {
+            if (lua_istable(L, -1))
+                lua_rawgeti(L, -1, i);
+            else
+                lua_pushvalue(L, -1);
+
+            if (!lua_isnumber(L, -1))
+                luaL_error(L, "Field %s must be a number or a list of numbers.", name);
+            int v = lua_tointeger(L, -1);
+            if (v >= first && v <= last)
+                (*set)[v - first] = true;
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+}
+
+static int check_scan_fields(lua_State *L, int idx)
+{
+    static const char *const names[] = { "tiletype", "designation", "occupancy", NULL };
+
+    if (lua_isnoneornil(L, idx))
+        return SCAN_TILETYPE;
+
+    if (!lua_istable(L, idx))
+        return 1 << luaL_checkoption(L, idx, NULL, names);
+
+    int fields = 0;
+    int cnt = lua_rawlen(L, idx);
+    for (int i = 1; i <= cnt; i++)
+    {
+        lua_rawgeti(L, idx, i);
+        fields |= 1 << luaL_checkoption(L, -1, NULL, names);
+        lua_pop(L, 1);
+    }
+    return fields;
+}
+
+static int maps_scan(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int fields = check_scan_fields(L, 2);
+
+    MapScanFilter filter;
+    if (!lua_isnoneornil(L, 3))
+    {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        check_scan_set(L, 3, "shape", &filter.shapes, &filter.has_shape,
+                       ENUM_FIRST_ITEM(tiletype_shape), ENUM_LAST_ITEM(tiletype_shape));
+        check_scan_set(L, 3, "material", &filter.materials, &filter.has_material,
+                       ENUM_FIRST_ITEM(tiletype_material), ENUM_LAST_ITEM(tiletype_material));
+
+        lua_getfield(L, 3, "hidden");
+        if (!lua_isnil(L, -1))
+        {
+            filter.has_hidden = true;
+            filter.hidden = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        get_int_field(L, &filter.min_flow, 3, "min_flow", 0);
+        get_int_field(L, &filter.max_flow, 3, "max_flow", 7);
+    }
+
+    int x1, y1, z1, x2, y2, z2;
+    get_int_field(L, &x1, 1, "x1", 0);
+    get_int_field(L, &y1, 1, "y1", 0);
+    get_int_field(L, &z1, 1, "z1", 0);
+    get_int_field(L, &x2, 1, "x2", x1);
+    get_int_field(L, &y2, 1, "y2", y1);
+    get_int_field(L, &z2, 1, "z2", z1);
+
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    if (z1 > z2) std::swap(z1, z2);
+
+    uint32_t bx_size = 0, by_size = 0, z_size = 0;
+    Maps::getSize(bx_size, by_size, z_size);
+    x1 = std::max(x1, 0); x2 = std::min(x2, int(bx_size*16)-1);
+    y1 = std::max(y1, 0); y2 = std::min(y2, int(by_size*16)-1);
+    z1 = std::max(z1, 0); z2 = std::min(z2, int(z_size)-1);
+
+    lua_settop(L, 3);
+    lua_newtable(L);
+    int result = lua_gettop(L);
+
+    // Result arrays: x, y, z, then the requested fields
+    const char *const names[] = { "x", "y", "z", "tiletype", "designation", "occupancy" };
+    bool active[6] = {
+        true, true, true,
+        bool(fields & SCAN_TILETYPE), bool(fields & SCAN_DESIGNATION), bool(fields & SCAN_OCCUPANCY)
+    };
+    int arrays[6];
+    for (int i = 0; i < 6; i++)
+    {
+        if (!active[i])
+            continue;
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, result, names[i]);
+        arrays[i] = lua_gettop(L);
+    }
+
+    int count = 0;
+
+    for (int z = z1; z <= z2; z++)
+    {
+        for (int by = (y1>>4); by <= (y2>>4); by++)
+        {
+            for (int bx = (x1>>4); bx <= (x2>>4); bx++)
+            {
+                df::map_block *block = Maps::getBlock(bx, by, z);
+                if (!block)
+                    continue;
+
+                int tx1 = std::max(x1 - bx*16, 0), tx2 = std::min(x2 - bx*16, 15);
+                int ty1 = std::max(y1 - by*16, 0), ty2 = std::min(y2 - by*16, 15);
+
+                for (int ty = ty1; ty <= ty2; ty++)
+                {
+                    for (int tx = tx1; tx <= tx2; tx++)
+                    {
+                        df::tiletype tt = convertTile(block->chr[tx][ty], block->color[tx][ty]);
+                        df::tile_designation des = block->designation[tx][ty];
+                        if (!filter.matches(tt, des))
+                            continue;
+
+                        int values[6] = {
+                            bx*16 + tx, by*16 + ty, z,
+                            tt, int(des.whole), int(block->occupancy[tx][ty].whole)
+                        };
+
+                        count++;
+                        for (int i = 0; i < 6; i++)
+                        {
+                            if (!active[i])
+                                continue;
+                            lua_pushinteger(L, values[i]);
+                            lua_rawseti(L, arrays[i], count);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    lua_settop(L, result);
+    lua_pushinteger(L, count);
+    lua_setfield(L, result, "count");
+    return 1;
+}
+
 static const luaL_Reg dfhack_maps_funcs[] = {
     { "isValidTilePos", maps_isValidTilePos },
     { "getTileBlock", maps_getTileBlock },
@@ -1497,6 +1704,7 @@ static const luaL_Reg dfhack_maps_funcs[] = {
     { "getTileType", maps_getTileType },
     { "getTileFlags", maps_getTileFlags },
     { "getRegionBiome", maps_getRegionBiome },
+    { "scan", maps_scan },
     { NULL, NULL }
 };
 
@@ -1539,6 +1747,28 @@ static int buildings_findCivzonesAt(lua_State *L)
     return 1;
 }
 
+static int buildings_findInBox(lua_State *L)
+{
+    df::coord p1, p2;
+    if (lua_istable(L, 1))
+    {
+        Lua::CheckDFAssign(L, &p1, 1);
+        Lua::CheckDFAssign(L, &p2, 2);
+    }
+    else
+    {
+        p1 = CheckCoordXYZ(L, 1);
+        p2 = CheckCoordXYZ(L, 4);
+    }
+
+    std::vector<df::building*> pvec;
+    if (Buildings::findInBox(&pvec, p1, p2))
+        Lua::PushVector(L, pvec);
+    else
+        lua_pushnil(L);
+    return 1;
+}
+
 static int buildings_getCorrectSize(lua_State *state)
 {
     df::coord2d size(luaL_optint(state, 1, 1), luaL_optint(state, 2, 1));
@@ -1586,6 +1816,7 @@ int buildings_setSize(lua_State *state)
 static const luaL_Reg dfhack_buildings_funcs[] = {
     { "findAtTile", buildings_findAtTile },
     { "findCivzonesAt", buildings_findCivzonesAt },
+    { "findInBox", buildings_findInBox },
     { "getCorrectSize", buildings_getCorrectSize },
     { "setSize", &Lua::CallWithCatchWrapper<buildings_setSize> },
     { NULL, NULL }
@@ -1668,6 +1899,76 @@ static int screen_fillRect(lua_State *L)
     return 1;
 }
 
+static int screen_blit(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int x = luaL_checkint(L, 2);
+    int y = luaL_checkint(L, 3);
+    int width = luaL_checkint(L, 4);
+    int count = lua_rawlen(L, 1);
+    if (width <= 0)
+        luaL_argerror(L, 4, "positive width expected");
+    if (count == 0)
+    {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+    int height = luaL_optint(L, 5, (count + width - 1) / width);
+    if (height <= 0)
+        luaL_argerror(L, 5, "positive height expected");
+    if (width > INT_MAX / height)
+        luaL_argerror(L, 5, "rectangle too large");
+
+    // Only the part inside the window is converted and painted
+    auto dim = Screen::getWindowSize();
+    int x1 = std::max(0, x), x2 = int(std::min<int64_t>(dim.x, int64_t(x) + width));
+    int y1 = std::max(0, y), y2 = int(std::min<int64_t>(dim.y, int64_t(y) + height));
+    if (x1 >= x2 || y1 >= y2)
+    {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+
+    int cw = x2 - x1, ch = y2 - y1;
+    std::vector<Pen> pens(cw*ch, Pen(0,0,0,-1));
+    for (int sy = y1; sy < y2; sy++)
+    {
+        for (int sx = x1; sx < x2; sx++)
+        {
+            int idx = (sy - y)*width + (sx - x);
+            if (idx >= count)
+                continue;
+
+            lua_rawgeti(L, 1, idx+1);
+            if (lua_toboolean(L, -1))
+                Lua::CheckPen(L, &pens[(sy - y1)*cw + (sx - x1)], -1, true, false);
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_pushboolean(L, Screen::blit(&pens[0], x1, y1, cw, ch));
+    return 1;
+}
+
+static int screen_markDirty(lua_State *L)
+{
+    auto screen = dfhack_viewscreen::try_cast(dfhack_lua_viewscreen::get_pointer(L, 1, false));
+    if (!screen)
+        luaL_argerror(L, 1, "not a dfhack screen");
+
+    if (lua_isnoneornil(L, 2))
+        screen->markDirty();
+    else
+    {
+        int x1 = luaL_checkint(L, 2);
+        int y1 = luaL_checkint(L, 3);
+        int x2 = luaL_checkint(L, 4);
+        int y2 = luaL_checkint(L, 5);
+        screen->markDirty(mkrect_xy(x1, y1, x2, y2));
+    }
+    return 0;
+}
+
 static int screen_findGraphicsTile(lua_State *L)
 {
     auto str = luaL_checkstring(L, 1);
@@ -1753,6 +2054,8 @@ static const luaL_Reg dfhack_screen_funcs[] = {
     { "readTile", screen_readTile },
     { "paintString", screen_paintString },
     { "fillRect", screen_fillRect },
+    { "blit", screen_blit },
+    { "markDirty", screen_markDirty },
     { "findGraphicsTile", screen_findGraphicsTile },
     { "show", &Lua::CallWithCatchWrapper<screen_show> },
     { "dismiss", screen_dismiss },
@@ -1775,6 +2078,123 @@ static const LuaWrapper::FunctionReg dfhack_filesystem_module[] = {
 };
 
 
+/***** Snapshot module *****/
+
+static const char *const snapshot_part_names[] = {
+    "units", "jobs", "items", "announcements", NULL
+};
+
+static int snapshot_check_parts(lua_State *state)
+{
+    int contents = 0;
+    for (int i = 1; i <= lua_gettop(state); i++)
+        contents |= 1 << luaL_checkoption(state, i, NULL, snapshot_part_names);
+    return contents;
+}
+
+static int snapshot_request(lua_State *state)
+{
+    Snapshot::Request(snapshot_check_parts(state));
+    return 0;
+}
+
+static int snapshot_release(lua_State *state)
+{
+    Snapshot::Release(snapshot_check_parts(state));
+    return 0;
+}
+
+static void snapshot_push_counts(lua_State *state, const std::vector<int32_t> &counts)
+{
+    lua_newtable(state);
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if (!counts[i])
+            continue;
+        lua_pushinteger(state, counts[i]);
+        lua_rawseti(state, -2, int(i));
+    }
+}
+
+static int snapshot_get(lua_State *state)
+{
+    // Holding the pointer keeps the data alive while it is copied;
+    // nothing here touches the live world.
+    Snapshot::Ptr snap = Snapshot::Get();
+    if (!snap)
+    {
+        lua_pushnil(state);
+        return 1;
+    }
+
+    lua_newtable(state);
+    Lua::SetField(state, snap->serial, -1, "serial");
+    Lua::SetField(state, snap->year, -1, "year");
+    Lua::SetField(state, snap->year_tick, -1, "year_tick");
+
+    if (snap->contents & Snapshot::UNITS)
+    {
+        lua_createtable(state, snap->units.size(), 0);
+        for (size_t i = 0; i < snap->units.size(); i++)
+        {
+            auto &unit = snap->units[i];
+            lua_createtable(state, 0, 7);
+            Lua::SetField(state, unit.id, -1, "id");
+            Lua::SetField(state, unit.pos, -1, "pos");
+            Lua::SetField(state, unit.race, -1, "race");
+            Lua::SetField(state, unit.civ_id, -1, "civ_id");
+            Lua::SetField(state, unit.profession, -1, "profession");
+            Lua::SetField(state, unit.flags1, -1, "flags1");
+            Lua::SetField(state, unit.flags2, -1, "flags2");
+            lua_rawseti(state, -2, i+1);
+        }
+        lua_setfield(state, -2, "units");
+    }
+
+    if (snap->contents & Snapshot::JOBS)
+    {
+        Lua::SetField(state, snap->job_count, -1, "job_count");
+        snapshot_push_counts(state, snap->jobs_by_type);
+        lua_setfield(state, -2, "jobs_by_type");
+    }
+
+    if (snap->contents & Snapshot::ITEMS)
+    {
+        snapshot_push_counts(state, snap->items_by_type);
+        lua_setfield(state, -2, "items_by_type");
+    }
+
+    if (snap->contents & Snapshot::ANNOUNCEMENTS)
+    {
+        lua_createtable(state, snap->announcements.size(), 0);
+        for (size_t i = 0; i < snap->announcements.size(); i++)
+        {
+            auto &info = snap->announcements[i];
+            lua_createtable(state, 0, 4);
+            Lua::SetField(state, info.text, -1, "text");
+            Lua::SetField(state, info.color, -1, "color");
+            Lua::SetField(state, info.bright, -1, "bright");
+            Lua::SetField(state, info.continuation, -1, "continuation");
+            lua_rawseti(state, -2, i+1);
+        }
+        lua_setfield(state, -2, "announcements");
+    }
+
+    return 1;
+}
+
+static const LuaWrapper::FunctionReg dfhack_snapshot_module[] = {
+    { NULL, NULL }
+};
+
+static const luaL_Reg dfhack_snapshot_funcs[] = {
+    { "request", snapshot_request },
+    { "release", snapshot_release },
+    { "get", snapshot_get },
+    { NULL, NULL }
+};
+
+
 /***** Internal module *****/
 
 static void *checkaddr(lua_State *L, int idx, bool allow_null = false)
@@ -2000,33 +2420,358 @@ static int internal_memcmp(lua_State *L)
     return 1;
 }
 
+/*
+ * Scan kernels for memscan and diffscan.
+ *
+ * The memscan prefilter looks for the first byte of any needle at the
+ * candidate offsets, and only then runs memcmp; diffscan skips over
+ * stretches of memory that are identical in both buffers. On x86 Linux
+ * builds the SSE2 and AVX2 variants are picked at runtime.
+ */
+
+#if defined(__GNUC__) && defined(__linux__) && (defined(__i386__) || defined(__x86_64__))
+#define DFHACK_SIMD_SCAN
+#include <immintrin.h>
+#endif
+
+struct ScanPrefilter {
+    int nbytes;             // distinct first bytes, valid if <= 4
+    uint8_t bytes[4];
+    bool table[256];
+
+    ScanPrefilter(const uint8_t *const *needles, int count) : nbytes(0) {
+        memset(table, 0, sizeof(table));
+        for (int i = 0; i < count; i++)
+        {
+            uint8_t b = needles[i][0];
+            if (table[b])
+                continue;
+            table[b] = true;
+            if (nbytes < 4)
+                bytes[nbytes] = b;
+            nbytes++;
+        }
+    }
+};
+
+// Returns the first i in [start, count] with p[i*step] passing the filter, or -1.
+typedef int (*prefilter_fn)(const uint8_t *p, int start, int count, int step, const ScanPrefilter &pf);
+// Returns the first offset in [start, end) where a and b differ, or end.
+typedef size_t (*diff_fn)(const uint8_t *a, const uint8_t *b, size_t start, size_t end);
+
+static int prefilter_scalar(const uint8_t *p, int start, int count, int step, const ScanPrefilter &pf)
+{
+    if (step == 1 && pf.nbytes == 1)
+    {
+        const void *hit = memchr(p + start, pf.bytes[0], count - start + 1);
+        return hit ? int((const uint8_t*)hit - p) : -1;
+    }
+
+    for (int i = start; i <= count; i++)
+        if (pf.table[p[i*step]])
+            return i;
+    return -1;
+}
+
+static size_t diff_scalar(const uint8_t *a, const uint8_t *b, size_t start, size_t end)
+{
+    size_t i = start;
+    for (; i + sizeof(uint32_t) <= end; i += sizeof(uint32_t))
+        if (*(const uint32_t*)(a+i) != *(const uint32_t*)(b+i))
+            break;
+    for (; i < end; i++)
+        if (a[i] != b[i])
+            return i;
+    return end;
+}
+
+#ifdef DFHACK_SIMD_SCAN
+
+// Bits of a byte compare mask that fall on multiples of the step
+static bool simd_step_mask(int step, uint32_t *mask)
+{
+    switch (step)
+    {
+    case 1: *mask = 0xFFFFFFFFU; return true;
+    case 2: *mask = 0x55555555U; return true;
+    case 4: *mask = 0x11111111U; return true;
+    case 8: *mask = 0x01010101U; return true;
+    case 16: *mask = 0x00010001U; return true;
+    default: return false;
+    }
+}
+
+__attribute__((target("sse2")))
+static int prefilter_sse2(const uint8_t *p, int start, int count, int step, const ScanPrefilter &pf)
+{
+    uint32_t stepmask;
+    if (pf.nbytes > 4 || !simd_step_mask(step, &stepmask))
+        return prefilter_scalar(p, start, count, step, pf);
+
+    __m128i keys[4];
+    for (int k = 0; k < pf.nbytes; k++)
+        keys[k] = _mm_set1_epi8(char(pf.bytes[k]));
+
+    // Only load chunks that end at or before the last candidate byte
+    int i = start;
+    int per_chunk = 16 / step;
+    for (; i*step + 15 <= count*step; i += per_chunk)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i*step));
+        __m128i eq = _mm_cmpeq_epi8(v, keys[0]);
+        for (int k = 1; k < pf.nbytes; k++)
+            eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, keys[k]));
+
+        uint32_t hits = uint32_t(_mm_movemask_epi8(eq)) & stepmask & 0xFFFFU;
+        if (hits)
+            return i + __builtin_ctz(hits) / step;
+    }
+
+    return (i <= count) ? prefilter_scalar(p, i, count, step, pf) : -1;
+}
+
+__attribute__((target("avx2")))
+static int prefilter_avx2(const uint8_t *p, int start, int count, int step, const ScanPrefilter &pf)
+{
+    uint32_t stepmask;
+    if (pf.nbytes > 4 || !simd_step_mask(step, &stepmask))
+        return prefilter_scalar(p, start, count, step, pf);
+
+    __m256i keys[4];
+    for (int k = 0; k < pf.nbytes; k++)
+        keys[k] = _mm256_set1_epi8(char(pf.bytes[k]));
+
+    int i = start;
+    int per_chunk = 32 / step;
+    for (; i*step + 31 <= count*step; i += per_chunk)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i*step));
+        __m256i eq = _mm256_cmpeq_epi8(v, keys[0]);
+        for (int k = 1; k < pf.nbytes; k++)
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, keys[k]));
+
+        uint32_t hits = uint32_t(_mm256_movemask_epi8(eq)) & stepmask;
+        if (hits)
+            return i + __builtin_ctz(hits) / step;
+    }
+
+    return (i <= count) ? prefilter_sse2(p, i, count, step, pf) : -1;
+}
+
+__attribute__((target("sse2")))
+static size_t diff_sse2(const uint8_t *a, const uint8_t *b, size_t start, size_t end)
+{
+    size_t i = start;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a+i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b+i));
+        uint32_t same = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+        if (same != 0xFFFFU)
+            return i + __builtin_ctz(~same);
+    }
+    return diff_scalar(a, b, i, end);
+}
+
+__attribute__((target("avx2")))
+static size_t diff_avx2(const uint8_t *a, const uint8_t *b, size_t start, size_t end)
+{
+    size_t i = start;
+    for (; i + 32 <= end; i += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a+i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b+i));
+        uint32_t same = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+        if (same != 0xFFFFFFFFU)
+            return i + __builtin_ctz(~same);
+    }
+    return diff_sse2(a, b, i, end);
+}
+
+#endif
+
+static prefilter_fn scan_prefilter = NULL;
+static diff_fn scan_diff = NULL;
+
+static void init_scan_kernels()
+{
+    if (scan_prefilter)
+        return;
+
+    scan_prefilter = prefilter_scalar;
+    scan_diff = diff_scalar;
+
+#ifdef DFHACK_SIMD_SCAN
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scan_prefilter = prefilter_avx2;
+        scan_diff = diff_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        scan_prefilter = prefilter_sse2;
+        scan_diff = diff_sse2;
+    }
+#endif
+}
+
+/*
+ * Finds the next i in [start, hcount] where one of the needles matches,
+ * storing the needle index in *which. Returns -1 if nothing matches.
+ */
+static int memscan_next(const uint8_t *haystack, int start, int hcount, int hstep,
+                        const std::vector<const uint8_t*> &needles, int nsize,
+                        const ScanPrefilter &pf, int *which)
+{
+    for (int i = start; i <= hcount; i++)
+    {
+        if (nsize > 0)
+        {
+            i = scan_prefilter(haystack, i, hcount, hstep, pf);
+            if (i < 0)
+                break;
+        }
+
+        const uint8_t *p = haystack + i*hstep;
+        for (size_t k = 0; k < needles.size(); k++)
+        {
+            if (memcmp(p, needles[k], nsize) == 0)
+            {
+                *which = int(k);
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+static void check_memscan_args(lua_State *L, uint8_t **haystack, int *hcount, int *hstep,
+                               std::vector<const uint8_t*> *needles, int *nsize)
+{
+    init_scan_kernels();
+
+    *haystack = (uint8_t*)checkaddr(L, 1);
+    *hcount = luaL_checkint(L, 2);
+    *hstep = luaL_checkint(L, 3);
+    if (*hstep == 0) luaL_argerror(L, 3, "zero step");
+
+    if (lua_istable(L, 4))
+    {
+        int cnt = lua_rawlen(L, 4);
+        if (cnt <= 0) luaL_argerror(L, 4, "empty needle list");
+        for (int i = 1; i <= cnt; i++)
+        {
+            lua_rawgeti(L, 4, i);
+            needles->push_back((const uint8_t*)checkaddr(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+    else
+        needles->push_back((const uint8_t*)checkaddr(L, 4));
+
+    *nsize = luaL_checkint(L, 5);
+    if (*nsize < 0) luaL_argerror(L, 5, "negative size");
+}
+
 static int internal_memscan(lua_State *L)
 {
-    uint8_t *haystack = (uint8_t*)checkaddr(L, 1);
-    int hcount = luaL_checkint(L, 2);
-    int hstep = luaL_checkint(L, 3);
-    if (hstep == 0) luaL_argerror(L, 3, "zero step");
-    void *needle = checkaddr(L, 4);
-    int nsize = luaL_checkint(L, 5);
-    if (nsize < 0) luaL_argerror(L, 5, "negative size");
-
-    for (int i = 0; i <= hcount; i++)
-    {
-        uint8_t *p = haystack + i*hstep;
-        if (memcmp(p, needle, nsize) == 0) {
-            lua_pushinteger(L, i);
-            lua_pushinteger(L, (lua_Integer)p);
-            return 2;
+    uint8_t *haystack;
+    int hcount, hstep, nsize;
+    std::vector<const uint8_t*> needles;
+    check_memscan_args(L, &haystack, &hcount, &hstep, &needles, &nsize);
+
+    ScanPrefilter pf(needles.data(), nsize > 0 ? needles.size() : 0);
+    int which = 0;
+    int i = memscan_next(haystack, 0, hcount, hstep, needles, nsize, pf, &which);
+
+    if (i < 0)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushinteger(L, i);
+    lua_pushinteger(L, (lua_Integer)(haystack + i*hstep));
+    if (needles.size() <= 1)
+        return 2;
+    lua_pushinteger(L, which+1);
+    return 3;
+}
+
+static int internal_memscanAll(lua_State *L)
+{
+    uint8_t *haystack;
+    int hcount, hstep, nsize;
+    std::vector<const uint8_t*> needles;
+    check_memscan_args(L, &haystack, &hcount, &hstep, &needles, &nsize);
+    int limit = luaL_optint(L, 6, 0);
+    bool multi = lua_istable(L, 4);
+
+    ScanPrefilter pf(needles.data(), nsize > 0 ? needles.size() : 0);
+
+    lua_settop(L, 6);
+    lua_newtable(L);
+    int indices = lua_gettop(L);
+    if (multi)
+        lua_newtable(L);
+
+    int found = 0, which = 0;
+    for (int i = 0; limit <= 0 || found < limit; i++)
+    {
+        i = memscan_next(haystack, i, hcount, hstep, needles, nsize, pf, &which);
+        if (i < 0)
+            break;
+
+        found++;
+        lua_pushinteger(L, i);
+        lua_rawseti(L, indices, found);
+        if (multi)
+        {
+            lua_pushinteger(L, which+1);
+            lua_rawseti(L, indices+1, found);
         }
     }
 
-    lua_pushnil(L);
-    return 1;
+    if (found == 0)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    return multi ? 2 : 1;
 }
 
-static int internal_diffscan(lua_State *L)
+template<class T>
+static int diffscan_next(const void *old_data, const void *new_data, int start, int end,
+                         bool has_oldv, T oldv, bool has_newv, T newv, bool has_diffv, T diffv)
 {
-    lua_settop(L, 8);
+    const T *pold = (const T*)old_data;
+    const T *pnew = (const T*)new_data;
+    size_t end_off = size_t(end)*sizeof(T);
+
+    for (int i = start; i < end; i++)
+    {
+        // Skip the identical prefix in one go
+        size_t off = scan_diff((const uint8_t*)pold, (const uint8_t*)pnew, size_t(i)*sizeof(T), end_off);
+        if (off >= end_off)
+            break;
+        i = int(off / sizeof(T));
+
+        if (has_oldv && pold[i] != oldv) continue;
+        if (has_newv && pnew[i] != newv) continue;
+        if (has_diffv && T(pnew[i]-pold[i]) != diffv) continue;
+        return i;
+    }
+
+    return -1;
+}
+
+static int do_diffscan(lua_State *L, int limit)
+{
+    init_scan_kernels();
+
     void *old_data = checkaddr(L, 1);
     void *new_data = checkaddr(L, 2);
     int start_idx = luaL_checkint(L, 3);
@@ -2035,20 +2780,26 @@ static int internal_diffscan(lua_State *L)
     bool has_oldv = !lua_isnil(L, 6);
     bool has_newv = !lua_isnil(L, 7);
     bool has_diffv = !lua_isnil(L, 8);
+    if (start_idx < 0) start_idx = 0;
+
+    // limit == 1 returns a single index, otherwise a table of them
+    if (limit != 1)
+        lua_newtable(L);
+
+    int found = 0;
 
 #define LOOP(esz, etype) \
     case esz: {          \
-        etype *pold = (etype*)old_data; \
-        etype *pnew = (etype*)new_data; \
         etype oldv = (etype)luaL_optint(L, 6, 0); \
         etype newv = (etype)luaL_optint(L, 7, 0); \
         etype diffv = (etype)luaL_optint(L, 8, 0); \
-        for (int i = start_idx; i < end_idx; i++) { \
-            if (pold[i] == pnew[i]) continue; \
-            if (has_oldv && pold[i] != oldv) continue; \
-            if (has_newv && pnew[i] != newv) continue; \
-            if (has_diffv && etype(pnew[i]-pold[i]) != diffv) continue; \
-            lua_pushinteger(L, i); return 1; \
+        for (int i = start_idx; limit <= 0 || found < limit; i++) { \
+            i = diffscan_next<etype>(old_data, new_data, i, end_idx, \
+                                     has_oldv, oldv, has_newv, newv, has_diffv, diffv); \
+            if (i < 0) break; \
+            lua_pushinteger(L, i); \
+            if (limit == 1) return 1; \
+            lua_rawseti(L, -2, ++found); \
         } \
         break; \
     }
@@ -2061,9 +2812,24 @@ static int internal_diffscan(lua_State *L)
     }
 #undef LOOP
 
-    lua_pushnil(L);
+    if (found == 0)
+        lua_pushnil(L);
     return 1;
 }
+
+static int internal_diffscan(lua_State *L)
+{
+    lua_settop(L, 8);
+    return do_diffscan(L, 1);
+}
+
+static int internal_diffscanAll(lua_State *L)
+{
+    lua_settop(L, 9);
+    int limit = luaL_optint(L, 9, 0);
+    return do_diffscan(L, limit);
+}
+
 static int internal_getDir(lua_State *L)
 {
     luaL_checktype(L,1,LUA_TSTRING);
@@ -2149,6 +2915,8 @@ static const luaL_Reg dfhack_internal_funcs[] = {
     { "memcmp", internal_memcmp },
     { "memscan", internal_memscan },
     { "diffscan", internal_diffscan },
+    { "memscanAll", internal_memscanAll },
+    { "diffscanAll", internal_diffscanAll },
     { "getDir", internal_getDir },
     { "runCommand", internal_runCommand },
     { NULL, NULL }
@@ -2175,5 +2943,12 @@ void OpenDFHackApi(lua_State *state)
     OpenModule(state, "buildings", dfhack_buildings_module, dfhack_buildings_funcs);
     OpenModule(state, "screen", dfhack_screen_module, dfhack_screen_funcs);
     OpenModule(state, "filesystem", dfhack_filesystem_module);
+    OpenModule(state, "snapshot", dfhack_snapshot_module, dfhack_snapshot_funcs);
     OpenModule(state, "internal", dfhack_internal_module, dfhack_internal_funcs);
 }
+
+// The whole api of pooled states, which must not reach live game data
+void OpenSnapshotApi(lua_State *state)
+{
+    OpenModule(state, "snapshot", dfhack_snapshot_module, dfhack_snapshot_funcs);
+}
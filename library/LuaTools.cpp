@@ -1554,13 +1554,12 @@ namespace DFHack { namespace Lua { namespace Core {
     static void InitCoreContext();
 }}}
 
-lua_State *DFHack::Lua::Open(color_ostream &out, lua_State *state)
-{
-    if (!state)
-        state = luaL_newstate();
+void OpenSnapshotApi(lua_State *state);
 
+// Sets up the parts shared by all states, leaving the dfhack table on the stack
+static void OpenBase(lua_State *state)
+{
     luaL_openlibs(state);
-    AttachDFGlobals(state);
 
     // Table of query coroutines
     lua_newtable(state);
@@ -1601,6 +1600,46 @@ lua_State *DFHack::Lua::Open(color_ostream &out, lua_State *state)
     lua_dup(state);
     lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_EXCEPTION_META_TOKEN);
     lua_setfield(state, -2, "exception");
+}
+
+// Sets the dfhack global and splits the global environment
+static void FinishOpen(lua_State *state)
+{
+    lua_setglobal(state, "dfhack");
+
+    // stash the loaded module table into our own registry key
+    lua_getglobal(state, "package");
+    assert(lua_istable(state, -1));
+    lua_getfield(state, -1, "loaded");
+    assert(lua_istable(state, -1));
+    lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_LOADED_TOKEN);
+    lua_pop(state, 1);
+
+    // replace some coroutine functions
+    lua_getglobal(state, "coroutine");
+    luaL_setfuncs(state, dfhack_coro_funcs, 0);
+    lua_pop(state, 1);
+
+    // split the global environment
+    lua_newtable(state);
+    lua_newtable(state);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_setfield(state, -2, "__index");
+    lua_setmetatable(state, -2);
+    lua_dup(state);
+    lua_setglobal(state, "_G");
+    lua_dup(state);
+    lua_rawseti(state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_pop(state, 1);
+}
+
+lua_State *DFHack::Lua::Open(color_ostream &out, lua_State *state)
+{
+    if (!state)
+        state = luaL_newstate();
+
+    OpenBase(state);
+    AttachDFGlobals(state);
 
     lua_newtable(state);
     lua_pushcfunction(state, dfhack_event_call);
@@ -1631,31 +1670,7 @@ lua_State *DFHack::Lua::Open(color_ostream &out, lua_State *state)
 
     OpenDFHackApi(state);
 
-    lua_setglobal(state, "dfhack");
-
-    // stash the loaded module table into our own registry key
-    lua_getglobal(state, "package");
-    assert(lua_istable(state, -1));
-    lua_getfield(state, -1, "loaded");
-    assert(lua_istable(state, -1));
-    lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_LOADED_TOKEN);
-    lua_pop(state, 1);
-
-    // replace some coroutine functions
-    lua_getglobal(state, "coroutine");
-    luaL_setfuncs(state, dfhack_coro_funcs, 0);
-    lua_pop(state, 1);
-
-    // split the global environment
-    lua_newtable(state);
-    lua_newtable(state);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
-    lua_setfield(state, -2, "__index");
-    lua_setmetatable(state, -2);
-    lua_dup(state);
-    lua_setglobal(state, "_G");
-    lua_dup(state);
-    lua_rawseti(state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    FinishOpen(state);
 
     // Init core-context specific stuff before loading dfhack.lua
     if (IsCoreContext(state))
@@ -1829,6 +1844,69 @@ void DFHack::Lua::Core::onUpdate(color_ostream &out)
         run_timers(out, State, tick_timers, frame[1], world->frame_counter);
 }
 
+static tthread::mutex pool_mutex;
+static std::vector<lua_State*> pool_free;
+
+static const luaL_Reg dfhack_pool_funcs[] = {
+    { "print", lua_dfhack_print },
+    { "println", lua_dfhack_println },
+    { "printerr", lua_dfhack_printerr },
+    { "color", lua_dfhack_color },
+    { "safecall", dfhack_safecall },
+    { "saferesume", dfhack_saferesume },
+    { "onerror", dfhack_onerror },
+    { "error", dfhack_error },
+    { "call_with_finalizer", dfhack_call_with_finalizer },
+    { "curry", dfhack_curry },
+    { NULL, NULL }
+};
+
+/*
+ * Pooled states run without the core suspended, so they get neither
+ * the df tree nor any api that reads the live game; dfhack.lua is not
+ * loaded either, since it needs both.
+ */
+static lua_State *OpenPoolState(color_ostream &out)
+{
+    lua_State *state = luaL_newstate();
+
+    OpenBase(state);
+    luaL_setfuncs(state, dfhack_pool_funcs, 0);
+    OpenSnapshotApi(state);
+    FinishOpen(state);
+
+    lua_settop(state, 0);
+    if (!lua_checkstack(state, 64))
+        out.printerr("Could not extend initial lua stack size to 64 items.\n");
+
+    return state;
+}
+
+lua_State *DFHack::Lua::Pool::Acquire(color_ostream &out)
+{
+    {
+        tthread::lock_guard<tthread::mutex> lock(pool_mutex);
+
+        if (!pool_free.empty())
+        {
+            lua_State *state = pool_free.back();
+            pool_free.pop_back();
+            return state;
+        }
+    }
+
+    // Don't hold the lock while opening a new state
+    return OpenPoolState(out);
+}
+
+void DFHack::Lua::Pool::Release(lua_State *state)
+{
+    lua_settop(state, 0);
+
+    tthread::lock_guard<tthread::mutex> lock(pool_mutex);
+    pool_free.push_back(state);
+}
+
 void DFHack::Lua::Core::Init(color_ostream &out)
 {
     if (State)
@@ -386,6 +386,91 @@ void bit_container_identity::lua_item_write(lua_State *state, int fname_idx, voi
         field_error(state, fname_idx, "boolean or number expected", "write");
 }
 
+/**
+ * Plain numeric struct fields are entered into the field table as full
+ * userdata with a precomputed accessor kind, so that reading and writing
+ * them bypasses the identity virtual calls.
+ */
+enum FieldAccessKind {
+    FIELD_GENERIC = 0,
+    FIELD_INT8, FIELD_UINT8,
+    FIELD_INT16, FIELD_UINT16,
+    FIELD_INT32, FIELD_UINT32,
+    FIELD_FLOAT, FIELD_BOOL
+};
+
+struct FieldAccessor {
+    const struct_field_info *field;
+    FieldAccessKind kind;
+};
+
+static FieldAccessKind get_field_access_kind(const struct_field_info *field)
+{
+    if (field->mode != struct_field_info::PRIMITIVE || !field->type)
+        return FIELD_GENERIC;
+
+    type_identity *type = field->type;
+    if (type->type() == IDTYPE_ENUM)
+        type = ((enum_identity*)type)->getBaseType();
+
+    if (type == df::identity_traits<int8_t>::get() || type == df::identity_traits<char>::get())
+        return FIELD_INT8;
+    if (type == df::identity_traits<uint8_t>::get())
+        return FIELD_UINT8;
+    if (type == df::identity_traits<int16_t>::get())
+        return FIELD_INT16;
+    if (type == df::identity_traits<uint16_t>::get())
+        return FIELD_UINT16;
+    if (type == df::identity_traits<int32_t>::get())
+        return FIELD_INT32;
+    if (type == df::identity_traits<uint32_t>::get())
+        return FIELD_UINT32;
+    if (type == df::identity_traits<float>::get())
+        return FIELD_FLOAT;
+    if (type == df::identity_traits<bool>::get())
+        return FIELD_BOOL;
+    return FIELD_GENERIC;
+}
+
+static void read_fast_field(lua_State *state, FieldAccessKind kind, void *ptr)
+{
+    switch (kind)
+    {
+    case FIELD_INT8: lua_pushinteger(state, *(int8_t*)ptr); return;
+    case FIELD_UINT8: lua_pushinteger(state, *(uint8_t*)ptr); return;
+    case FIELD_INT16: lua_pushinteger(state, *(int16_t*)ptr); return;
+    case FIELD_UINT16: lua_pushinteger(state, *(uint16_t*)ptr); return;
+    case FIELD_INT32: lua_pushnumber(state, *(int32_t*)ptr); return;
+    case FIELD_UINT32: lua_pushnumber(state, *(uint32_t*)ptr); return;
+    case FIELD_FLOAT: lua_pushnumber(state, *(float*)ptr); return;
+    case FIELD_BOOL: lua_pushboolean(state, *(bool*)ptr); return;
+    default: lua_pushnil(state); return;
+    }
+}
+
+template<class T>
+static inline void write_fast_number(lua_State *state, void *ptr, int value_idx)
+{
+    if (!lua_isnumber(state, value_idx))
+        field_error(state, 2, "number expected", "write");
+    *(T*)ptr = T(lua_tonumber(state, value_idx));
+}
+
+static bool write_fast_field(lua_State *state, FieldAccessKind kind, void *ptr, int value_idx)
+{
+    switch (kind)
+    {
+    case FIELD_INT8: write_fast_number<int8_t>(state, ptr, value_idx); return true;
+    case FIELD_UINT8: write_fast_number<uint8_t>(state, ptr, value_idx); return true;
+    case FIELD_INT16: write_fast_number<int16_t>(state, ptr, value_idx); return true;
+    case FIELD_UINT16: write_fast_number<uint16_t>(state, ptr, value_idx); return true;
+    case FIELD_INT32: write_fast_number<int32_t>(state, ptr, value_idx); return true;
+    case FIELD_UINT32: write_fast_number<uint32_t>(state, ptr, value_idx); return true;
+    case FIELD_FLOAT: write_fast_number<float>(state, ptr, value_idx); return true;
+    default: return false;
+    }
+}
+
 /**
  * Resolve the field name in UPVAL_FIELDTABLE, die if not found.
  */
@@ -405,10 +490,14 @@ static int get_metafield(lua_State *state)
     return 1;
 }
 
-static void *find_field(lua_State *state, int index, const char *mode)
+static void *find_field(lua_State *state, int index, const char *mode,
+                        FieldAccessKind *pkind = NULL)
 {
     lookup_field(state, index, mode);
 
+    if (pkind)
+        *pkind = FIELD_GENERIC;
+
     // Methods
     if (lua_isfunction(state, -1))
         return NULL;
@@ -418,6 +507,16 @@ static void *find_field(lua_State *state, int index, const char *mode)
         field_error(state, index, "corrupted field table", mode);
 
     void *p = lua_touserdata(state, -1);
+
+    // Full userdata => field with an accessor
+    if (p && !lua_islightuserdata(state, -1))
+    {
+        auto acc = (FieldAccessor*)p;
+        if (pkind)
+            *pkind = acc->kind;
+        p = (void*)acc->field;
+    }
+
     lua_pop(state, 1);
 
     // NULL => metafield
@@ -605,10 +704,14 @@ static void write_field(lua_State *state, const struct_field_info *field, void *
 static int meta_struct_index(lua_State *state)
 {
     uint8_t *ptr = get_object_addr(state, 1, 2, "read");
-    auto field = (struct_field_info*)find_field(state, 2, "read");
+    FieldAccessKind kind;
+    auto field = (struct_field_info*)find_field(state, 2, "read", &kind);
     if (!field)
         return 1;
-    read_field(state, field, ptr + field->offset);
+    if (kind != FIELD_GENERIC)
+        read_fast_field(state, kind, ptr + field->offset);
+    else
+        read_field(state, field, ptr + field->offset);
     return 1;
 }
 
@@ -633,10 +736,12 @@ static int meta_struct_field_reference(lua_State *state)
 static int meta_struct_newindex(lua_State *state)
 {
     uint8_t *ptr = get_object_addr(state, 1, 2, "write");
-    auto field = (struct_field_info*)find_field(state, 2, "write");
+    FieldAccessKind kind;
+    auto field = (struct_field_info*)find_field(state, 2, "write", &kind);
     if (!field)
         field_error(state, 2, "builtin property or method", "write");
-    write_field(state, field, ptr + field->offset, 3);
+    if (!write_fast_field(state, kind, ptr + field->offset, 3))
+        write_field(state, field, ptr + field->offset, 3);
     return 0;
 }
 
@@ -900,6 +1005,233 @@ static int method_container_insert(lua_State *state)
     return 0;
 }
 
+/*
+ * Bulk field access for containers of structures: a field path such as
+ * 'pos.x' is resolved once into offsets, then applied to every item.
+ */
+
+struct ProjectPath {
+    std::vector<int> derefs;            // offsets of pointers to follow
+    int offset;                         // final offset, including the field
+    const struct_field_info *field;
+    FieldAccessKind kind;
+};
+
+static const struct_field_info *find_struct_field(struct_identity *type, const char *name)
+{
+    for (struct_identity *p = type; p; p = p->getParent())
+    {
+        auto fields = p->getFields();
+        if (!fields)
+            continue;
+
+        for (int i = 0; fields[i].mode != struct_field_info::END; ++i)
+            if (strcmp(fields[i].name, name) == 0)
+                return &fields[i];
+    }
+
+    return NULL;
+}
+
+static bool is_struct_type(type_identity *type)
+{
+    return type && (type->type() == IDTYPE_STRUCT || type->type() == IDTYPE_CLASS);
+}
+
+static void parse_project_path(lua_State *state, type_identity *item, int name_idx, ProjectPath *path)
+{
+    if (lua_type(state, name_idx) != LUA_TSTRING)
+        luaL_error(state, "Field path must be a string");
+
+    std::string spec = lua_tostring(state, name_idx);
+    std::vector<std::string> parts;
+    split_string(&parts, spec, ".");
+
+    type_identity *type = item;
+    path->derefs.clear();
+    path->offset = 0;
+    path->field = NULL;
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (!is_struct_type(type))
+            luaL_error(state, "Cannot index a non-structure in field path '%s'", spec.c_str());
+
+        auto field = find_struct_field((struct_identity*)type, parts[i].c_str());
+        if (!field || field->mode == struct_field_info::OBJ_METHOD ||
+            field->mode == struct_field_info::CLASS_METHOD)
+            luaL_error(state, "Field '%s' not found in %s", parts[i].c_str(),
+                       type->getFullName().c_str());
+
+        path->offset += field->offset;
+
+        if (i+1 == parts.size())
+        {
+            path->field = field;
+            path->kind = get_field_access_kind(field);
+        }
+        else if (field->mode == struct_field_info::SUBSTRUCT)
+            type = field->type;
+        else if (field->mode == struct_field_info::POINTER)
+        {
+            path->derefs.push_back(path->offset);
+            path->offset = 0;
+            type = field->type;
+        }
+        else
+            luaL_error(state, "Cannot index field '%s' in field path '%s'",
+                       parts[i].c_str(), spec.c_str());
+    }
+}
+
+static uint8_t *resolve_project_path(const ProjectPath &path, uint8_t *item)
+{
+    for (size_t i = 0; item && i < path.derefs.size(); i++)
+        item = *(uint8_t**)(item + path.derefs[i]);
+    return item ? item + path.offset : NULL;
+}
+
+static uint8_t *get_project_item(container_identity *id, type_identity *item, void *ptr, int idx)
+{
+    switch (id->type())
+    {
+    case IDTYPE_PTR_CONTAINER:
+    case IDTYPE_STL_PTR_VECTOR:
+    case IDTYPE_STL2_PTR_VECTOR:
+        return *(uint8_t**)id->get_item_pointer(&df::identity_traits<void*>::identity, ptr, idx);
+    default:
+        return (uint8_t*)id->get_item_pointer(item, ptr, idx);
+    }
+}
+
+/**
+ * Method: copy the listed fields of all items into column tables.
+ */
+static int method_container_project(lua_State *state)
+{
+    uint8_t *ptr = check_method_call(state, 0, 1);
+
+    auto id = (container_identity*)lua_touserdata(state, UPVAL_CONTAINER_ID);
+    auto item = (type_identity*)lua_touserdata(state, UPVAL_ITEM_ID);
+    int len = id->lua_item_count(state, ptr, container_identity::COUNT_READ);
+
+    // No field list: copy out the items themselves
+    if (lua_isnoneornil(state, 2))
+    {
+        lua_createtable(state, len, 0);
+        for (int i = 0; i < len; i++)
+        {
+            id->lua_item_read(state, UPVAL_METHOD_NAME, ptr, i);
+            lua_rawseti(state, -2, i+1);
+        }
+        lua_pushinteger(state, len);
+        return 2;
+    }
+
+    luaL_checktype(state, 2, LUA_TTABLE);
+    if (!is_struct_type(item))
+        field_error(state, UPVAL_METHOD_NAME, "items are not structures", "call");
+
+    int nfields = lua_rawlen(state, 2);
+    std::vector<ProjectPath> paths(nfields);
+
+    lua_settop(state, 2);
+    luaL_checkstack(state, nfields + 4, "too many fields");
+    lua_createtable(state, 0, nfields);
+
+    for (int k = 0; k < nfields; k++)
+    {
+        lua_rawgeti(state, 2, k+1);
+        parse_project_path(state, item, -1, &paths[k]);
+        lua_createtable(state, len, 0);
+        lua_pushvalue(state, -1);
+        lua_insert(state, -3);
+        lua_rawset(state, 3);
+        // stack: result columns...
+    }
+
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t *pitem = get_project_item(id, item, ptr, i);
+
+        for (int k = 0; k < nfields; k++)
+        {
+            uint8_t *pfield = resolve_project_path(paths[k], pitem);
+            if (!pfield)
+                continue;
+
+            if (paths[k].kind != FIELD_GENERIC)
+                read_fast_field(state, paths[k].kind, pfield);
+            else
+                read_field(state, paths[k].field, pfield);
+            lua_rawseti(state, 4+k, i+1);
+        }
+    }
+
+    lua_settop(state, 3);
+    lua_pushinteger(state, len);
+    return 2;
+}
+
+/**
+ * Method: write column tables back into the fields of all items.
+ */
+static int method_container_store(lua_State *state)
+{
+    uint8_t *ptr = check_method_call(state, 1, 1);
+    luaL_checktype(state, 2, LUA_TTABLE);
+
+    auto id = (container_identity*)lua_touserdata(state, UPVAL_CONTAINER_ID);
+    auto item = (type_identity*)lua_touserdata(state, UPVAL_ITEM_ID);
+    int len = id->lua_item_count(state, ptr, container_identity::COUNT_WRITE);
+
+    if (id->is_readonly())
+        field_error(state, UPVAL_METHOD_NAME, "container is read-only", "call");
+    if (!is_struct_type(item))
+        field_error(state, UPVAL_METHOD_NAME, "items are not structures", "call");
+
+    lua_settop(state, 2);
+
+    // Collect the columns on the stack, starting at index 3
+    std::vector<ProjectPath> paths;
+    lua_pushnil(state);
+    while (lua_next(state, 2))
+    {
+        luaL_checktype(state, -1, LUA_TTABLE);
+        paths.push_back(ProjectPath());
+        parse_project_path(state, item, -2, &paths.back());
+
+        // stack: columns... key value -> columns... value key
+        luaL_checkstack(state, 3, "too many fields");
+        lua_insert(state, -2);
+    }
+
+    int nfields = paths.size();
+    int value_idx = 3 + nfields;
+
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t *pitem = get_project_item(id, item, ptr, i);
+
+        for (int k = 0; k < nfields; k++)
+        {
+            lua_rawgeti(state, 3+k, i+1);
+            if (!lua_isnil(state, value_idx))
+            {
+                uint8_t *pfield = resolve_project_path(paths[k], pitem);
+                if (!pfield)
+                    field_error(state, UPVAL_METHOD_NAME, "NULL pointer in field path", "call");
+
+                if (!write_fast_field(state, paths[k].kind, pfield, value_idx))
+                    write_field(state, paths[k].field, pfield, value_idx);
+            }
+            lua_settop(state, value_idx-1);
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Metamethod: __len for bitfields.
  */
@@ -1200,7 +1532,15 @@ static void IndexFields(lua_State *state, int base, struct_identity *pstruct, bo
         if (add_to_enum)
             AssociateId(state, base+3, ++cnt, name.c_str());
 
-        lua_pushlightuserdata(state, (void*)&fields[i]);
+        FieldAccessKind kind = globals ? FIELD_GENERIC : get_field_access_kind(&fields[i]);
+        if (kind != FIELD_GENERIC)
+        {
+            auto acc = (FieldAccessor*)lua_newuserdata(state, sizeof(FieldAccessor));
+            acc->field = &fields[i];
+            acc->kind = kind;
+        }
+        else
+            lua_pushlightuserdata(state, (void*)&fields[i]);
         lua_setfield(state, base+2, name.c_str());
     }
 }
@@ -1337,6 +1677,8 @@ static void MakeContainerMetatable(lua_State *state, container_identity *type,
     AddContainerMethodFun(state, base+1, base+2, method_container_resize, "resize", type, item, count);
     AddContainerMethodFun(state, base+1, base+2, method_container_erase, "erase", type, item, count);
     AddContainerMethodFun(state, base+1, base+2, method_container_insert, "insert", type, item, count);
+    AddContainerMethodFun(state, base+1, base+2, method_container_project, "project", type, item, count);
+    AddContainerMethodFun(state, base+1, base+2, method_container_store, "store", type, item, count);
 
     // push the index table
     AttachEnumKeys(state, base+1, base+2, ienum);
@@ -177,6 +177,46 @@ void LuaWrapper::push_object_ref(lua_State *state, void *ptr)
     // stack: [userdata]
 }
 
+/**
+ * Like push_object_ref, but reuses a live ref to the same address with
+ * the same metatable. Refs are never modified after creation, so handing
+ * out the same userdata again is indistinguishable from a fresh one.
+ */
+void LuaWrapper::push_cached_object_ref(lua_State *state, void *ptr)
+{
+    // stack: [metatable]
+    lua_rawgetp(state, LUA_REGISTRYINDEX, &DFHACK_REF_CACHE_TOKEN);
+    if (lua_isnil(state, -1))
+    {
+        lua_pop(state, 1);
+        push_object_ref(state, ptr);
+        return;
+    }
+
+    // stack: [metatable cache]
+    lua_rawgetp(state, -1, ptr);
+    if (lua_isuserdata(state, -1) && lua_getmetatable(state, -1))
+    {
+        bool same = lua_rawequal(state, -1, -4);
+        lua_pop(state, 1);
+        if (same)
+        {
+            lua_replace(state, -3);
+            lua_pop(state, 1);
+            return;
+        }
+    }
+    lua_pop(state, 1);
+
+    // stack: [metatable cache] -> [cache userdata]
+    lua_swap(state);
+    push_object_ref(state, ptr);
+    lua_dup(state);
+    lua_rawsetp(state, -3, ptr);
+    lua_remove(state, -2);
+    // stack: [userdata]
+}
+
 void *LuaWrapper::get_object_ref(lua_State *state, int val_index)
 {
     assert(!lua_islightuserdata(state, val_index));
@@ -224,7 +264,7 @@ void LuaWrapper::push_object_internal(lua_State *state, type_identity *type, voi
     if (!LookupTypeInfo(state, in_method)) // type -> metatable?
         BuildTypeMetatable(state, type); // () -> metatable
 
-    push_object_ref(state, ptr); // metatable -> userdata
+    push_cached_object_ref(state, ptr); // metatable -> userdata
 }
 
 static void fetch_container_details(lua_State *state, int meta, type_identity **pitem, int *pcount)
@@ -1574,6 +1614,14 @@ static int DoAttach(lua_State *state)
     lua_newtable(state);
     lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_EMPTY_TABLE_TOKEN);
 
+    // Weak-valued cache of object refs by address
+    lua_newtable(state);
+    lua_newtable(state);
+    lua_pushstring(state, "v");
+    lua_setfield(state, -2, "__mode");
+    lua_setmetatable(state, -2);
+    lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_REF_CACHE_TOKEN);
+
     lua_pushcfunction(state, change_error);
     lua_setfield(state, LUA_REGISTRYINDEX, DFHACK_CHANGEERROR_NAME);
 
@@ -1696,4 +1744,5 @@ namespace DFHack { namespace LuaWrapper {
     LuaToken DFHACK_ENUM_TABLE_TOKEN;
     LuaToken DFHACK_PTR_IDTABLE_TOKEN;
     LuaToken DFHACK_EMPTY_TABLE_TOKEN;
+    LuaToken DFHACK_REF_CACHE_TOKEN;
 }}
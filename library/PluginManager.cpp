@@ -33,6 +33,9 @@ distribution.
 
 #include "DataDefs.h"
 #include "MiscUtils.h"
+#include "modules/World.h"
+
+#include "df/world.h"
 
 #include "LuaWrapper.h"
 #include "LuaTools.h"
@@ -42,6 +45,9 @@ using namespace DFHack;
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
 using namespace std;
 
 #include "tinythread.h"
@@ -175,6 +181,9 @@ Plugin::Plugin(Core * core, const std::string & filepath, const std::string & _f
     plugin_rpcconnect = 0;
     plugin_enable = 0;
     plugin_is_enabled = 0;
+    plugin_update_cadence = 0;
+    update_due = update_phase = 0;
+    update_scheduled = update_in_ticks = false;
     state = PS_UNLOADED;
     access = new RefLock();
 }
@@ -251,6 +260,7 @@ bool Plugin::load(color_ostream &con)
     plugin_rpcconnect = (RPCService* (*)(color_ostream &)) LookupPlugin(plug, "plugin_rpcconnect");
     plugin_enable = (command_result (*)(color_ostream &,bool)) LookupPlugin(plug, "plugin_enable");
     plugin_is_enabled = (bool*) LookupPlugin(plug, "plugin_is_enabled");
+    plugin_update_cadence = (PluginUpdateCadence*) LookupPlugin(plug, "plugin_update_cadence");
     plugin_eval_ruby = (command_result (*)(color_ostream &, const char*)) LookupPlugin(plug, "plugin_eval_ruby");
     index_lua(plug);
     this->name = *plug_name;
@@ -260,6 +270,8 @@ bool Plugin::load(color_ostream &con)
     {
         state = PS_LOADED;
         parent->registerCommands(this);
+        if (plugin_onupdate)
+            parent->addUpdateHook(this);
         if ((plugin_onupdate || plugin_enable) && !plugin_is_enabled)
             con.printerr("Plugin %s has no enabled var!\n", name.c_str());
         return true;
@@ -268,6 +280,7 @@ bool Plugin::load(color_ostream &con)
     {
         con.printerr("Plugin %s has failed to initialize properly.\n", filename.c_str());
         plugin_is_enabled = 0;
+        plugin_update_cadence = 0;
         plugin_onupdate = 0;
         reset_lua();
         ClosePlugin(plugin_lib);
@@ -304,7 +317,9 @@ bool Plugin::unload(color_ostream &con)
         if(plugin_shutdown)
             cr = plugin_shutdown(con);
         // cleanup...
+        parent->removeUpdateHook(this);
         plugin_is_enabled = 0;
+        plugin_update_cadence = 0;
         plugin_onupdate = 0;
         reset_lua();
         parent->unregisterCommands(this);
@@ -437,6 +452,43 @@ command_result Plugin::on_update(color_ostream &out)
     return cr;
 }
 
+bool Plugin::is_update_due(uint32_t frame, uint32_t tick, bool paused)
+{
+    if (plugin_is_enabled && !*plugin_is_enabled)
+        return false;
+    if (!plugin_update_cadence)
+        return true;
+
+    // Plain reads: the plugin may change its cadence at any time
+    int interval = plugin_update_cadence->interval;
+    int flags = plugin_update_cadence->flags;
+
+    if ((flags & UPDATE_UNPAUSED) && paused)
+        return false;
+    if ((flags & UPDATE_PAUSED) && !paused)
+        return false;
+    if (interval <= 1)
+        return true;
+
+    bool in_ticks = (flags & UPDATE_TICKS) != 0;
+    uint32_t now = in_ticks ? tick : frame;
+
+    // (Re)start the schedule at this plugin's phase, so that
+    // plugins with the same interval don't all run in one frame.
+    if (!update_scheduled || update_in_ticks != in_ticks)
+    {
+        update_scheduled = true;
+        update_in_ticks = in_ticks;
+        update_due = now + update_phase % interval;
+    }
+
+    if (int32_t(now - update_due) < 0)
+        return false;
+
+    update_due = now + interval;
+    return true;
+}
+
 command_result Plugin::on_render(color_ostream &out)
 {
     command_result cr = CR_NOT_IMPLEMENTED;
@@ -695,6 +747,9 @@ PluginManager::PluginManager(Core * core)
 {
     cmdlist_mutex = new mutex();
     ruby = NULL;
+    update_frame = update_tick = 0;
+    last_frame_counter = 0;
+    next_update_phase = 0;
 }
 
 PluginManager::~PluginManager()
@@ -707,6 +762,64 @@ PluginManager::~PluginManager()
     delete cmdlist_mutex;
 }
 
+/*
+ * Reads plugin files on background threads ahead of the loader, so that
+ * dlopen on the main thread finds them in the OS file cache instead of
+ * waiting for the disk. dlopen itself stays serial: the dynamic linker
+ * holds a global lock while loading, and plugin constructors touch core state.
+ */
+struct PluginPrefetcher
+{
+    const vector <string> &files;
+    tthread::mutex lock;
+    size_t next;
+    vector <tthread::thread *> threads;
+
+    PluginPrefetcher(const vector <string> &files, unsigned count)
+        : files(files), next(0)
+    {
+        for (unsigned i = 0; i < count; i++)
+            threads.push_back(new tthread::thread(run, this));
+    }
+
+    ~PluginPrefetcher()
+    {
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i]->join();
+            delete threads[i];
+        }
+    }
+
+    static void run(void *arg)
+    {
+        PluginPrefetcher *self = (PluginPrefetcher*)arg;
+        vector <char> buf(64*1024);
+
+        for (;;)
+        {
+            string file;
+            {
+                tthread::lock_guard<tthread::mutex> guard(self->lock);
+                if (self->next >= self->files.size())
+                    return;
+                file = self->files[self->next++];
+            }
+
+            FILE *f = fopen(file.c_str(), "rb");
+            if (!f)
+                continue;
+            while (fread(&buf[0], 1, buf.size(), f) == buf.size()) {}
+            fclose(f);
+        }
+    }
+};
+
+static bool compare_load_time(const pair<uint32_t, string> &a, const pair<uint32_t, string> &b)
+{
+    return a.first > b.first;
+}
+
 void PluginManager::init(Core * core)
 {
 #ifdef LINUX_BUILD
@@ -718,16 +831,41 @@ void PluginManager::init(Core * core)
 #endif
     vector <string> filez;
     getdir(path, filez);
+    // load in the same order regardless of the directory listing
+    std::sort(filez.begin(), filez.end());
+
+    vector <string> plugin_files, plugin_paths;
     for(size_t i = 0; i < filez.size();i++)
     {
         if(hasEnding(filez[i],searchstr))
         {
-            Plugin * p = new Plugin(core, path + filez[i], filez[i], this);
-            all_plugins.push_back(p);
-            // make all plugins load by default (until a proper design emerges).
-            p->load(core->getConsole());
+            plugin_files.push_back(filez[i]);
+            plugin_paths.push_back(path + filez[i]);
         }
     }
+
+    unsigned nthreads = std::min(4u, std::max(1u, tthread::thread::hardware_concurrency()));
+    PluginPrefetcher prefetch(plugin_paths, nthreads);
+
+    vector <pair<uint32_t, string> > load_times;
+    uint32_t start = core->p->getTickCount();
+
+    for(size_t i = 0; i < plugin_files.size();i++)
+    {
+        Plugin * p = new Plugin(core, plugin_paths[i], plugin_files[i], this);
+        all_plugins.push_back(p);
+        // make all plugins load by default (until a proper design emerges).
+        uint32_t plugin_start = core->p->getTickCount();
+        p->load(core->getConsole());
+        load_times.push_back(make_pair(core->p->getTickCount() - plugin_start, p->name));
+    }
+
+    // report where startup time went, slowest first
+    std::sort(load_times.begin(), load_times.end(), compare_load_time);
+    std::cerr << "Loaded " << plugin_files.size() << " plugins in "
+              << (core->p->getTickCount() - start) << " ms:" << endl;
+    for (size_t i = 0; i < load_times.size(); i++)
+        std::cerr << "  " << load_times[i].second << ": " << load_times[i].first << " ms" << endl;
 }
 
 Plugin *PluginManager::getPluginByName (const std::string & name)
@@ -765,12 +903,49 @@ bool PluginManager::CanInvokeHotkey(const std::string &command, df::viewscreen *
 
 void PluginManager::OnUpdate(color_ostream &out)
 {
-    for(size_t i = 0; i < all_plugins.size(); i++)
+    update_frame++;
+
+    // count game ticks that passed since the last frame
+    auto world = df::global::world;
+    if (world && world->frame_counter != last_frame_counter)
+    {
+        uint32_t delta = world->frame_counter - last_frame_counter;
+        // a loaded save jumps arbitrarily
+        update_tick += (delta <= 1000) ? delta : 1;
+        last_frame_counter = world->frame_counter;
+    }
+
+    bool paused = World::ReadPauseState();
+
+    for(size_t i = 0; i < update_plugins.size(); i++)
     {
-        all_plugins[i]->on_update(out);
+        Plugin *plug = update_plugins[i];
+        if (plug->is_update_due(update_frame, update_tick, paused))
+            plug->on_update(out);
     }
 }
 
+// Called with the core suspended
+void PluginManager::addUpdateHook( Plugin * p )
+{
+    if (std::find(update_plugins.begin(), update_plugins.end(), p) != update_plugins.end())
+        return;
+
+    // spread the phases of periodic plugins
+    p->update_phase = next_update_phase;
+    next_update_phase += 7;
+    p->update_scheduled = false;
+
+    update_plugins.push_back(p);
+}
+
+void PluginManager::removeUpdateHook( Plugin * p )
+{
+    auto it = std::find(update_plugins.begin(), update_plugins.end(), p);
+    if (it != update_plugins.end())
+        update_plugins.erase(it);
+}
+
 void PluginManager::OnRender(color_ostream &out)
 {
     for(size_t i = 0; i < all_plugins.size(); i++)
@@ -44,6 +44,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <istream>
 #include <string>
 #include <stdint.h>
+#include <string.h>
 
 #include "RemoteClient.h"
 #include <ActiveSocket.h>
@@ -54,6 +55,13 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 
 #include <memory>
+#include <algorithm>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <zlib.h>
 
 using namespace DFHack;
 
@@ -63,6 +71,9 @@ using namespace tthread;
 using dfproto::CoreTextNotification;
 
 using google::protobuf::MessageLite;
+using google::protobuf::io::ZeroCopyOutputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
 
 const char RPCHandshakeHeader::REQUEST_MAGIC[9] = "DFHack?\n";
 const char RPCHandshakeHeader::RESPONSE_MAGIC[9] = "DFHack!\n";
@@ -93,6 +104,8 @@ RemoteClient::RemoteClient(color_ostream *default_output)
     active = false;
     socket = new CActiveSocket();
     suspend_ready = false;
+    want_compression = false;
+    zstream = NULL;
 
     if (!p_default_output)
     {
@@ -107,6 +120,7 @@ RemoteClient::~RemoteClient()
 {
     disconnect();
     delete socket;
+    delete zstream;
 
     if (delete_output)
         delete p_default_output;
@@ -166,6 +180,8 @@ bool RemoteClient::connect(int port)
     RPCHandshakeHeader header;
     memcpy(header.magic, RPCHandshakeHeader::REQUEST_MAGIC, sizeof(header.magic));
     header.version = 1;
+    if (want_compression)
+        header.version |= RPC_CAP_ZLIB;
 
     if (socket->Send((uint8*)&header, sizeof(header)) != sizeof(header))
     {
@@ -182,13 +198,19 @@ bool RemoteClient::connect(int port)
     }
 
     if (memcmp(header.magic, RPCHandshakeHeader::RESPONSE_MAGIC, sizeof(header.magic)) ||
-        header.version != 1)
+        (header.version & RPCHandshakeHeader::VERSION_MASK) != 1)
     {
         default_output().printerr("Invalid handshake response.\n");
         socket->Close();
         return active = false;
     }
 
+    delete zstream;
+    zstream = NULL;
+
+    if (want_compression && (header.version & RPC_CAP_ZLIB))
+        zstream = new RPCZStream(false);
+
     bind_call.name = "BindMethod";
     bind_call.p_client = this;
     bind_call.id = 0;
@@ -324,24 +346,347 @@ bool RemoteFunctionBase::bind(color_ostream &out, RemoteClient *client,
     return client->bind(out, this, name, proto);
 }
 
-bool sendRemoteMessage(CSimpleSocket *socket, int16_t id, const MessageLite *msg, bool size_ready)
+void RPCReplyStream::clear(bool free)
 {
-    int size = size_ready ? msg->GetCachedSize() : msg->ByteSize();
-    int fullsz = size + sizeof(RPCMessageHeader);
+    // Keep one chunk around for the next reply unless asked to free
+    size_t keep = (free || chunks.empty() || chunks[0].size > CHUNK_SIZE) ? 0 : 1;
 
-    uint8_t *data = new uint8_t[fullsz];
-    RPCMessageHeader *hdr = (RPCMessageHeader*)data;
+    for (size_t i = keep; i < chunks.size(); i++)
+        delete[] chunks[i].data;
+
+    chunks.resize(keep);
+    if (keep)
+        chunks[0].used = 0;
+
+    total_size = 0;
+}
+
+uint8_t *RPCReplyStream::reserve(int size)
+{
+    if (chunks.empty() || chunks.back().size - chunks.back().used < size)
+    {
+        Chunk chunk;
+        chunk.size = std::max(size, int(CHUNK_SIZE));
+        chunk.used = 0;
+        chunk.data = new uint8_t[chunk.size];
+        chunks.push_back(chunk);
+    }
+
+    Chunk &last = chunks.back();
+    uint8_t *ptr = last.data + last.used;
+    last.used += size;
+    total_size += size;
+    return ptr;
+}
+
+void RPCReplyStream::add(int field, const message_type &item)
+{
+    uint32_t tag = WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    int size = item.ByteSize();
+    int head = CodedOutputStream::VarintSize32(tag) + CodedOutputStream::VarintSize32(size);
+
+    // Serialize straight into the chunk memory
+    uint8_t *ptr = reserve(head + size);
+    ptr = CodedOutputStream::WriteTagToArray(tag, ptr);
+    ptr = CodedOutputStream::WriteVarint32ToArray(size, ptr);
+    item.SerializeWithCachedSizesToArray(ptr);
+}
+
+RPCZStream::RPCZStream(bool deflate)
+    : deflating(deflate), valid(false), output_used(0)
+{
+    z_stream *zs = new z_stream;
+    memset(zs, 0, sizeof(z_stream));
+
+    if (deflating)
+        valid = (deflateInit(zs, Z_BEST_SPEED) == Z_OK);
+    else
+        valid = (inflateInit(zs) == Z_OK);
+
+    stream = zs;
+}
+
+RPCZStream::~RPCZStream()
+{
+    z_stream *zs = (z_stream*)stream;
+
+    if (valid)
+    {
+        if (deflating)
+            deflateEnd(zs);
+        else
+            inflateEnd(zs);
+    }
+
+    delete zs;
+}
+
+void RPCZStream::reset_output(int reserve)
+{
+    if (output.size() < size_t(reserve))
+        output.resize(reserve);
+
+    output_used = reserve;
+}
+
+bool RPCZStream::compress(const void *data, int size, bool flush)
+{
+    if (!valid || !deflating)
+        return false;
+
+    z_stream *zs = (z_stream*)stream;
+    zs->next_in = (Bytef*)data;
+    zs->avail_in = size;
+
+    do {
+        if (output.size() - output_used < 1024)
+            output.resize(std::max(output.size()*2, size_t(output_used + 16*1024)));
+
+        zs->next_out = &output[output_used];
+        zs->avail_out = output.size() - output_used;
+
+        int rv = ::deflate(zs, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+        output_used = output.size() - zs->avail_out;
+
+        if (rv != Z_OK && rv != Z_BUF_ERROR)
+        {
+            valid = false;
+            return false;
+        }
+    } while (zs->avail_in > 0 || (flush && zs->avail_out == 0));
+
+    return true;
+}
+
+bool RPCZStream::decompress(void *out, int out_size, const void *data, int size)
+{
+    if (!valid || deflating)
+        return false;
+
+    z_stream *zs = (z_stream*)stream;
+    zs->next_in = (Bytef*)data;
+    zs->avail_in = size;
+    zs->next_out = (Bytef*)out;
+    zs->avail_out = out_size;
+
+    while (zs->avail_in > 0)
+    {
+        int rv = ::inflate(zs, Z_SYNC_FLUSH);
+
+        if (rv != Z_OK)
+        {
+            // The stream can't recover from losing data
+            valid = false;
+            return false;
+        }
+    }
+
+    return zs->avail_out == 0;
+}
+
+/*
+ * Collects output in a fixed buffer and passes it on whenever it fills
+ * up, so that messages are encoded without a copy of the whole.
+ */
+class BufferedOutputStream : public ZeroCopyOutputStream {
+    static const int BUFFER_SIZE = 16*1024;
+
+    uint8_t buffer[BUFFER_SIZE];
+    int used;
+    int64_t total;
+    bool failed;
+
+protected:
+    virtual bool write(const uint8_t *data, int size) = 0;
+
+    bool send(const uint8_t *data, int size)
+    {
+        if (!failed && size > 0 && !write(data, size))
+            failed = true;
+        return !failed;
+    }
+
+public:
+    BufferedOutputStream() : used(0), total(0), failed(false) {}
+
+    virtual bool Next(void **data, int *size)
+    {
+        if (used == BUFFER_SIZE && !Flush())
+            return false;
 
+        *data = buffer + used;
+        *size = BUFFER_SIZE - used;
+        total += BUFFER_SIZE - used;
+        used = BUFFER_SIZE;
+        return true;
+    }
+
+    virtual void BackUp(int count)
+    {
+        used -= count;
+        total -= count;
+    }
+
+    virtual google::protobuf::int64 ByteCount() const { return total; }
+
+    bool Flush()
+    {
+        bool ok = send(buffer, used);
+        used = 0;
+        return ok;
+    }
+
+    // Small blocks are coalesced into the buffer, large ones are passed on as is.
+    bool WriteBlock(const uint8_t *data, int size)
+    {
+        total += size;
+
+        if (size > BUFFER_SIZE - used)
+        {
+            if (!Flush())
+                return false;
+
+            if (size > BUFFER_SIZE/2)
+                return send(data, size);
+        }
+
+        memcpy(buffer + used, data, size);
+        used += size;
+        return !failed;
+    }
+};
+
+class SocketOutputStream : public BufferedOutputStream {
+    CSimpleSocket *socket;
+
+protected:
+    virtual bool write(const uint8_t *data, int size) {
+        return socket->Send(data, size) == size;
+    }
+
+public:
+    SocketOutputStream(CSimpleSocket *socket) : socket(socket) {}
+};
+
+class DeflateOutputStream : public BufferedOutputStream {
+    RPCZStream *zstream;
+
+protected:
+    virtual bool write(const uint8_t *data, int size) {
+        return zstream->compress(data, size, false);
+    }
+
+public:
+    DeflateOutputStream(RPCZStream *zstream) : zstream(zstream) {}
+};
+
+static bool sendCompressedMessage(CSimpleSocket *socket, int16_t id, const MessageLite *msg,
+                                  const RPCReplyStream *tail, int size, RPCZStream *zstream)
+{
+    const int prefix = sizeof(RPCMessageHeader) + sizeof(int32_t);
+
+    zstream->reset_output(prefix);
+
+    DeflateOutputStream output(zstream);
+
+    {
+        CodedOutputStream coded(&output);
+        msg->SerializeWithCachedSizes(&coded);
+        if (coded.HadError())
+            return false;
+    }
+
+    if (tail)
+    {
+        for (int i = 0; i < tail->chunk_count(); i++)
+            if (!output.WriteBlock(tail->chunk_data(i), tail->chunk_size(i)))
+                return false;
+    }
+
+    if (!output.Flush() || !zstream->compress(NULL, 0, true))
+        return false;
+
+    uint8_t *data = zstream->output_data();
+    int fullsz = zstream->output_size();
+
+    RPCMessageHeader *hdr = (RPCMessageHeader*)data;
     hdr->id = id;
-    hdr->size = size;
+    hdr->size = (fullsz - sizeof(RPCMessageHeader)) | RPCMessageHeader::COMPRESSED;
+    memcpy(data + sizeof(RPCMessageHeader), &size, sizeof(int32_t));
+
+    return socket->Send(data, fullsz) == fullsz;
+}
+
+bool sendRemoteMessage(CSimpleSocket *socket, int16_t id, const MessageLite *msg, bool size_ready,
+                       const RPCReplyStream *tail = NULL, RPCZStream *zstream = NULL)
+{
+    int size = size_ready ? msg->GetCachedSize() : msg->ByteSize();
+    if (tail)
+        size += tail->size();
+
+    if (zstream && size >= RPCMessageHeader::COMPRESS_THRESHOLD)
+        return sendCompressedMessage(socket, id, msg, tail, size, zstream);
+
+    RPCMessageHeader hdr;
+    hdr.id = id;
+    hdr.size = size;
+
+    SocketOutputStream output(socket);
+
+    {
+        CodedOutputStream coded(&output);
+        coded.WriteRaw(&hdr, sizeof(hdr));
+        msg->SerializeWithCachedSizes(&coded);
+        if (coded.HadError())
+            return false;
+    }
+
+    if (tail)
+    {
+        for (int i = 0; i < tail->chunk_count(); i++)
+            if (!output.WriteBlock(tail->chunk_data(i), tail->chunk_size(i)))
+                return false;
+    }
+
+    return output.Flush();
+}
+
+/*
+ * Reads the body of a message whose header was already received,
+ * decompressing it if needed. Updates size to the decoded length.
+ */
+static uint8_t *readRemoteMessage(CSimpleSocket *socket, int32_t &size, RPCZStream *zstream)
+{
+    if (!(size & RPCMessageHeader::COMPRESSED))
+    {
+        uint8_t *buf = new uint8_t[size];
+        if (!readFullBuffer(socket, buf, size))
+        {
+            delete[] buf;
+            return NULL;
+        }
+        return buf;
+    }
+
+    int32_t packed_size = size & ~RPCMessageHeader::COMPRESSED;
+    if (!zstream || packed_size < int(sizeof(int32_t)))
+        return NULL;
 
-    uint8_t *pstart = data + sizeof(RPCMessageHeader);
-    uint8_t *pend = msg->SerializeWithCachedSizesToArray(pstart);
-    assert((pend - pstart) == size);
+    std::vector<uint8_t> packed(packed_size);
+    if (!readFullBuffer(socket, &packed[0], packed_size))
+        return NULL;
 
-    int got = socket->Send(data, fullsz);
-    delete[] data;
-    return (got == fullsz);
+    memcpy(&size, &packed[0], sizeof(int32_t));
+    if (size < 0 || size > RPCMessageHeader::MAX_MESSAGE_SIZE)
+        return NULL;
+
+    uint8_t *buf = new uint8_t[size];
+    if (!zstream->decompress(buf, size, &packed[sizeof(int32_t)], packed_size - sizeof(int32_t)))
+    {
+        delete[] buf;
+        return NULL;
+    }
+    return buf;
 }
 
 command_result RemoteFunctionBase::execute(color_ostream &out,
@@ -397,19 +742,21 @@ command_result RemoteFunctionBase::execute(color_ostream &out,
         if ((DFHack::DFHackReplyCode)header.id == RPC_REPLY_FAIL)
             return header.size == CR_OK ? CR_FAILURE : command_result(header.size);
 
-        if (header.size < 0 || header.size > RPCMessageHeader::MAX_MESSAGE_SIZE)
+        int32_t body_size = header.size & ~RPCMessageHeader::COMPRESSED;
+
+        if (header.size < 0 || body_size > RPCMessageHeader::MAX_MESSAGE_SIZE)
         {
             out.printerr("In call to %s::%s: invalid received size %d.\n",
                          this->proto.c_str(), this->name.c_str(), header.size);
             return CR_LINK_FAILURE;
         }
 
-        uint8_t *buf = new uint8_t[header.size];
+        uint8_t *buf = readRemoteMessage(p_client->socket, header.size, p_client->zstream);
 
-        if (!readFullBuffer(p_client->socket, buf, header.size))
+        if (!buf)
         {
             out.printerr("In call to %s::%s: I/O error in receive %d bytes of data.\n",
-                         this->proto.c_str(), this->name.c_str(), header.size);
+                         this->proto.c_str(), this->name.c_str(), body_size);
             return CR_LINK_FAILURE;
         }
 
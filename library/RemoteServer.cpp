@@ -57,6 +57,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 
 #include <memory>
+#include <algorithm>
 
 using namespace DFHack;
 
@@ -69,7 +70,8 @@ using google::protobuf::MessageLite;
 
 bool readFullBuffer(CSimpleSocket *socket, void *buf, int size);
 bool sendRemoteMessage(CSimpleSocket *socket, int16_t id,
-                        const ::google::protobuf::MessageLite *msg, bool size_ready);
+                        const ::google::protobuf::MessageLite *msg, bool size_ready,
+                        const RPCReplyStream *tail = NULL, RPCZStream *zstream = NULL);
 
 
 RPCService::RPCService()
@@ -108,10 +110,46 @@ void RPCService::finalize(ServerConnection *owner, std::vector<ServerFunctionBas
     }
 }
 
+// Messages smaller than this are never freed between calls
+static const int MIN_SHRINK_IN_SIZE = 32*1024;
+static const int MIN_SHRINK_OUT_SIZE = 128*1024;
+
+void ServerFunctionBase::finish_call(int in_size, int out_size)
+{
+    // Free the messages after calls much larger than the usual for
+    // this function, so that one big request doesn't pin its memory;
+    // functions that are always big keep theirs.
+    bool free_bufs = (flags & SF_CALLED_ONCE) ||
+                     in_size > std::max(MIN_SHRINK_IN_SIZE, 4*stats.avg_in_size) ||
+                     out_size > std::max(MIN_SHRINK_OUT_SIZE, 4*stats.avg_out_size);
+
+    reset(free_bufs);
+
+    if (free_bufs)
+        stats.frees++;
+
+    if (stats.calls++ == 0)
+    {
+        stats.avg_in_size = in_size;
+        stats.avg_out_size = out_size;
+    }
+    else
+    {
+        stats.avg_in_size += (in_size - stats.avg_in_size) / 8;
+        stats.avg_out_size += (out_size - stats.avg_out_size) / 8;
+    }
+
+    stats.max_in_size = std::max(stats.max_in_size, in_size);
+    stats.max_out_size = std::max(stats.max_out_size, out_size);
+}
+
 ServerConnection::ServerConnection(CActiveSocket *socket)
     : socket(socket), stream(this)
 {
     in_error = false;
+    zstream = NULL;
+    avg_in_size = 0;
+    in_buf_frees = 0;
 
     core_service = new CoreService();
     core_service->finalize(this, &functions);
@@ -129,6 +167,7 @@ ServerConnection::~ServerConnection()
         delete it->second;
 
     delete core_service;
+    delete zstream;
 }
 
 ServerFunctionBase *ServerConnection::findFunction(color_ostream &out, const std::string &plugin, const std::string &name)
@@ -188,7 +227,7 @@ void ServerConnection::connection_ostream::flush_proxy()
 
     buffer.clear();
 
-    if (!sendRemoteMessage(owner->socket, RPC_REPLY_TEXT, &msg, false))
+    if (!sendRemoteMessage(owner->socket, RPC_REPLY_TEXT, &msg, false, NULL, owner->zstream))
     {
         owner->in_error = true;
         Core::printerr("Error writing text into client socket.\n");
@@ -219,8 +258,11 @@ void ServerConnection::threadFn()
             return;
         }
 
+        int version = header.version & RPCHandshakeHeader::VERSION_MASK;
+        int caps = header.version & ~RPCHandshakeHeader::VERSION_MASK;
+
         if (memcmp(header.magic, RPCHandshakeHeader::REQUEST_MAGIC, sizeof(header.magic)) ||
-            header.version < 1 || header.version > 255)
+            version < 1)
         {
             out << "In RPC server: invalid handshake header." << endl;
             return;
@@ -229,6 +271,18 @@ void ServerConnection::threadFn()
         memcpy(header.magic, RPCHandshakeHeader::RESPONSE_MAGIC, sizeof(header.magic));
         header.version = 1;
 
+        if (caps & RPC_CAP_ZLIB)
+        {
+            zstream = new RPCZStream(true);
+            if (zstream->isValid())
+                header.version |= RPC_CAP_ZLIB;
+            else
+            {
+                delete zstream;
+                zstream = NULL;
+            }
+        }
+
         if (socket->Send((uint8*)&header, sizeof(header)) != sizeof(header))
         {
             out << "In RPC server: could not send handshake response." << endl;
@@ -259,9 +313,10 @@ void ServerConnection::threadFn()
             break;
         }
 
-        std::auto_ptr<uint8_t> buf(new uint8_t[header.size]);
+        if (in_buf.size() < size_t(header.size) || in_buf.empty())
+            in_buf.resize(std::max(header.size, 1));
 
-        if (!readFullBuffer(socket, buf.get(), header.size))
+        if (!readFullBuffer(socket, &in_buf[0], header.size))
         {
             out.printerr("In RPC server: I/O error in receive %d bytes of data.\n", header.size);
             break;
@@ -282,14 +337,12 @@ void ServerConnection::threadFn()
         }
         else
         {
-            if (!fn->in()->ParseFromArray(buf.get(), header.size))
+            if (!fn->in()->ParseFromArray(&in_buf[0], header.size))
             {
                 stream.printerr("In call to %s: could not decode input args.\n", fn->name);
             }
             else
             {
-                buf.reset();
-
                 reply = fn->out();
 
                 if (fn->flags & SF_DONT_SUSPEND)
@@ -311,7 +364,8 @@ void ServerConnection::threadFn()
         //out.print("Answer %d:%d\n", res, reply);
 
         // Send reply
-        int out_size = (reply ? reply->ByteSize() : 0);
+        RPCReplyStream *tail = (fn ? fn->reply_stream() : NULL);
+        int out_size = (reply ? reply->ByteSize() : 0) + (tail ? tail->size() : 0);
 
         if (out_size > RPCMessageHeader::MAX_MESSAGE_SIZE)
         {
@@ -324,7 +378,7 @@ void ServerConnection::threadFn()
 
         if (res == CR_OK && reply)
         {
-            if (!sendRemoteMessage(socket, RPC_REPLY_RESULT, reply, true))
+            if (!sendRemoteMessage(socket, RPC_REPLY_RESULT, reply, true, tail, zstream))
             {
                 out.printerr("In RPC server: I/O error in send result.\n");
                 break;
@@ -345,12 +399,31 @@ void ServerConnection::threadFn()
         // Cleanup
         if (fn)
         {
-            fn->reset((fn->flags & SF_CALLED_ONCE) ||
-                      (out_size > 128*1024 || in_size > 32*1024));
+            int frees = fn->getStats().frees;
+            fn->finish_call(in_size, out_size);
+            if (tail)
+                tail->clear(fn->getStats().frees != frees);
         }
+
+        if (int(in_buf.size()) > std::max(MIN_SHRINK_IN_SIZE, 4*avg_in_size))
+        {
+            std::vector<uint8_t>().swap(in_buf);
+            in_buf_frees++;
+        }
+        avg_in_size += (in_size - avg_in_size) / 8;
+    }
+
+    int calls = 0, frees = in_buf_frees;
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+        if (!functions[i])
+            continue;
+        calls += functions[i]->getStats().calls;
+        frees += functions[i]->getStats().frees;
     }
 
-    std::cerr << "Shutting down client connection." << endl;
+    std::cerr << "Shutting down client connection (" << calls << " calls, "
+              << frees << " buffer frees)." << endl;
 }
 
 ServerMain::ServerMain()
@@ -54,6 +54,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "modules/Translation.h"
 #include "modules/Units.h"
 #include "modules/World.h"
+#include "modules/Snapshot.h"
 
 #include "LuaTools.h"
 
@@ -81,6 +82,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 
 #include <memory>
+#include <algorithm>
 
 using namespace DFHack;
 using namespace df::enums;
@@ -244,15 +246,14 @@ static command_result GetDFVersion(color_ostream &stream,
     return CR_OK;
 }
 
-static command_result GetWorldInfo(color_ostream &stream,
-                                   const EmptyMessage *, GetWorldInfoOut *out)
+bool DFHack::describeWorldInfo(GetWorldInfoOut *out)
 {
     using df::global::ui;
     using df::global::ui_advmode;
     using df::global::world;
 
     if (!ui || !world || !Core::getInstance().isWorldLoaded())
-        return CR_NOT_FOUND;
+        return false;
 
     df::game_type gt = game_type::DWARF_MAIN;
     if (df::global::gametype)
@@ -302,10 +303,45 @@ static command_result GetWorldInfo(color_ostream &stream,
         break;
 
     default:
-        return CR_NOT_FOUND;
+        return false;
     }
 
-    return CR_OK;
+    return true;
+}
+
+/*
+ * GetWorldInfo and ListUnits run without suspending the core, and reply
+ * from the snapshot published at the end of the last tick. Binding them
+ * requests the snapshot parts they need, so only the first calls on a
+ * connection, and calls made while the connection holds the core through
+ * CoreSuspend, suspend and read the live game instead.
+ */
+static Snapshot::Ptr getSnapshot(int contents)
+{
+    if (Core::getInstance().isSuspended())
+        return Snapshot::Ptr();
+
+    Snapshot::Ptr snap = Snapshot::Get();
+    if (!snap || (snap->contents & contents) != contents)
+        return Snapshot::Ptr();
+
+    return snap;
+}
+
+static command_result GetWorldInfo(color_ostream &stream,
+                                   const EmptyMessage *, GetWorldInfoOut *out)
+{
+    if (Snapshot::Ptr snap = getSnapshot(Snapshot::WORLD_INFO))
+    {
+        if (!snap->world_info)
+            return CR_NOT_FOUND;
+
+        out->CopyFrom(*snap->world_info);
+        return CR_OK;
+    }
+
+    CoreSuspender suspend;
+    return describeWorldInfo(out) ? CR_OK : CR_NOT_FOUND;
 }
 
 static command_result ListEnums(color_ostream &stream,
@@ -369,18 +405,26 @@ static command_result ListJobSkills(color_ostream &stream, const EmptyMessage *,
     return CR_OK;
 }
 
-static command_result ListUnits(color_ostream &stream,
-                                const ListUnitsIn *in, ListUnitsOut *out)
+static int listLiveUnits(const ListUnitsIn *in, RPCReplyStream *reply)
 {
     auto mask = in->has_mask() ? &in->mask() : NULL;
 
+    // Units are encoded one by one, reusing the same message
+    BasicUnitInfo info;
+    int count = 0;
+
     if (in->id_list_size() > 0)
     {
         for (int i = 0; i < in->id_list_size(); i++)
         {
             auto unit = df::unit::find(in->id_list(i));
             if (unit)
-                describeUnit(out->add_value(), unit, mask);
+            {
+                info.Clear();
+                describeUnit(&info, unit, mask);
+                reply->add(ListUnitsOut::kValueFieldNumber, info);
+                count++;
+            }
         }
     }
 
@@ -403,11 +447,109 @@ static command_result ListUnits(color_ostream &stream,
             if (in->has_sane() && Units::isSane(unit) != in->sane())
                 continue;
 
-            describeUnit(out->add_value(), unit, mask);
+            info.Clear();
+            describeUnit(&info, unit, mask);
+            reply->add(ListUnitsOut::kValueFieldNumber, info);
+            count++;
         }
     }
 
-    return out->value_size() ? CR_OK : CR_NOT_FOUND;
+    return count;
+}
+
+static bool compareUnitId(const Snapshot::UnitDetails &a, int32_t id)
+{
+    return a.id < id;
+}
+
+static void addUnitDetails(RPCReplyStream *reply, BasicUnitInfo &info,
+                           const Snapshot::UnitDetails &unit, const BasicUnitInfoMask *mask)
+{
+    // The snapshot has every optional part, so send it as is if all are wanted
+    if (mask && mask->profession() && mask->labors() && mask->skills() && mask->misc_traits())
+    {
+        reply->add(ListUnitsOut::kValueFieldNumber, *unit.info);
+        return;
+    }
+
+    info.CopyFrom(*unit.info);
+
+    if (!mask || !mask->profession())
+    {
+        info.clear_squad_id();
+        info.clear_squad_position();
+        info.clear_profession();
+        info.clear_custom_profession();
+    }
+    if (!mask || !mask->labors())
+        info.clear_labors();
+    if (!mask || !mask->skills())
+        info.clear_skills();
+    if (!mask || !mask->misc_traits())
+        info.clear_misc_traits();
+
+    reply->add(ListUnitsOut::kValueFieldNumber, info);
+}
+
+static int listSnapshotUnits(const Snapshot::WorldSnapshot &snap, const ListUnitsIn *in,
+                             RPCReplyStream *reply)
+{
+    auto mask = in->has_mask() ? &in->mask() : NULL;
+    auto &units = snap.unit_details;
+
+    BasicUnitInfo info;
+    int count = 0;
+
+    for (int i = 0; i < in->id_list_size(); i++)
+    {
+        auto it = std::lower_bound(units.begin(), units.end(), in->id_list(i), compareUnitId);
+        if (it != units.end() && it->id == in->id_list(i))
+        {
+            addUnitDetails(reply, info, *it, mask);
+            count++;
+        }
+    }
+
+    if (in->scan_all())
+    {
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            auto &unit = units[i];
+
+            if (in->has_race() && unit.race != in->race())
+                continue;
+            if (in->has_civ_id() && unit.civ_id != in->civ_id())
+                continue;
+            if (in->has_dead() && unit.dead != in->dead())
+                continue;
+            if (in->has_alive() && unit.alive != in->alive())
+                continue;
+            if (in->has_sane() && unit.sane != in->sane())
+                continue;
+
+            addUnitDetails(reply, info, unit, mask);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static command_result ListUnits(color_ostream &stream,
+                                const ListUnitsIn *in, ListUnitsOut *out,
+                                RPCReplyStream *reply)
+{
+    int count;
+
+    if (Snapshot::Ptr snap = getSnapshot(Snapshot::UNIT_DETAILS))
+        count = listSnapshotUnits(*snap, in, reply);
+    else
+    {
+        CoreSuspender suspend;
+        count = listLiveUnits(in, reply);
+    }
+
+    return count ? CR_OK : CR_NOT_FOUND;
 }
 
 static command_result SetUnitLabors(color_ostream &stream, const SetUnitLaborsIn *in)
@@ -421,11 +563,14 @@ static command_result SetUnitLabors(color_ostream &stream, const SetUnitLaborsIn
             unit->status.labors[change.labor()] = change.value();
     }
 
+    // so that ListUnits sees the change even while the game is paused
+    Snapshot::Invalidate();
     return CR_OK;
 }
 
 CoreService::CoreService() {
     suspend_depth = 0;
+    snapshot_parts = 0;
 
     // These 2 methods must be first, so that they get id 0 and 1
     addMethod("BindMethod", &CoreService::BindMethod, SF_DONT_SUSPEND);
@@ -436,17 +581,18 @@ CoreService::CoreService() {
     addMethod("CoreResume", &CoreService::CoreResume, SF_DONT_SUSPEND);
 
     addMethod("RunLua", &CoreService::RunLua);
+    addMethod("RunLuaReadOnly", &CoreService::RunLuaReadOnly, SF_DONT_SUSPEND);
 
     // Functions:
     addFunction("GetVersion", GetVersion, SF_DONT_SUSPEND);
     addFunction("GetDFVersion", GetDFVersion, SF_DONT_SUSPEND);
 
-    addFunction("GetWorldInfo", GetWorldInfo);
+    addFunction("GetWorldInfo", GetWorldInfo, SF_DONT_SUSPEND);
 
     addFunction("ListEnums", ListEnums, SF_CALLED_ONCE | SF_DONT_SUSPEND);
     addFunction("ListJobSkills", ListJobSkills, SF_CALLED_ONCE | SF_DONT_SUSPEND);
 
-    addFunction("ListUnits", ListUnits);
+    addFunction("ListUnits", ListUnits, SF_DONT_SUSPEND);
 
     addFunction("SetUnitLabors", SetUnitLabors);
 }
@@ -455,6 +601,8 @@ CoreService::~CoreService()
 {
     while (suspend_depth-- > 0)
         Core::getInstance().Resume();
+
+    Snapshot::Release(snapshot_parts);
 }
 
 command_result CoreService::BindMethod(color_ostream &stream,
@@ -478,6 +626,22 @@ command_result CoreService::BindMethod(color_ostream &stream,
         return CR_FAILURE;
     }
 
+    // Start capturing what the snapshot-backed functions reply with
+    if (in->plugin().empty())
+    {
+        int parts = 0;
+        if (in->method() == "GetWorldInfo")
+            parts = Snapshot::WORLD_INFO;
+        else if (in->method() == "ListUnits")
+            parts = Snapshot::UNIT_DETAILS;
+
+        if (parts & ~snapshot_parts)
+        {
+            Snapshot::Request(parts & ~snapshot_parts);
+            snapshot_parts |= parts;
+        }
+    }
+
     out->set_assigned_id(fn->getId());
     return CR_OK;
 }
@@ -534,6 +698,23 @@ command_result CoreService::RunLua(color_ostream &stream,
     return data.rv;
 }
 
+command_result CoreService::RunLuaReadOnly(color_ostream &stream,
+                                           const dfproto::CoreRunLuaRequest *in,
+                                           StringListMessage *out)
+{
+    auto L = Lua::Pool::Acquire(stream);
+    LuaFunctionData data = { CR_FAILURE, in, out };
+
+    lua_pushcfunction(L, doRunLuaFunction);
+    lua_pushlightuserdata(L, &data);
+
+    if (!Lua::SafeCall(stream, L, 1, 0))
+        data.rv = CR_FAILURE;
+
+    Lua::Pool::Release(L);
+    return data.rv;
+}
+
 int CoreService::doRunLuaFunction(lua_State *L)
 {
     color_ostream &out = *Lua::GetOutput(L);
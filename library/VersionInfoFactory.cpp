@@ -29,11 +29,14 @@ distribution.
 #include <algorithm>
 #include <map>
 #include <iostream>
+#include <cstdio>
+#include <cstring>
 using namespace std;
 
 #include "VersionInfoFactory.h"
 #include "VersionInfo.h"
 #include "Error.h"
+#include "modules/Filesystem.h"
 using namespace DFHack;
 
 #include <tinyxml.h>
@@ -56,11 +59,34 @@ void VersionInfoFactory::clear()
         delete versions[i];
     }
     versions.clear();
+    md5_index.clear();
+    pe_index.clear();
     error = false;
 }
 
+void VersionInfoFactory::buildIndex()
+{
+    md5_index.clear();
+    pe_index.clear();
+
+    // insert() keeps the first match, like the linear search did
+    for(size_t i = 0; i < versions.size();i++)
+    {
+        VersionInfo *v = versions[i];
+        for (size_t j = 0; j < v->md5_list.size(); j++)
+            md5_index.insert(make_pair(v->md5_list[j], v));
+        for (size_t j = 0; j < v->PE_list.size(); j++)
+            pe_index.insert(make_pair(v->PE_list[j], v));
+    }
+}
+
 VersionInfo * VersionInfoFactory::getVersionInfoByMD5(string hash)
 {
+    auto it = md5_index.find(hash);
+    if (it != md5_index.end())
+        return it->second;
+
+    // versions is public and may have been filled by hand
     for(size_t i = 0; i < versions.size();i++)
     {
         if(versions[i]->hasMD5(hash))
@@ -71,6 +97,10 @@ VersionInfo * VersionInfoFactory::getVersionInfoByMD5(string hash)
 
 VersionInfo * VersionInfoFactory::getVersionInfoByPETimestamp(uint32_t timestamp)
 {
+    auto it = pe_index.find(timestamp);
+    if (it != pe_index.end())
+        return it->second;
+
     for(size_t i = 0; i < versions.size();i++)
     {
         if(versions[i]->hasPE(timestamp))
@@ -159,8 +189,253 @@ void VersionInfoFactory::ParseVersion (TiXmlElement* entry, VersionInfo* mem)
     } // for
 } // method
 
-// load the XML file with offsets
+/*
+ * Symbol cache
+ *
+ * The parsed symbol tables are stored in a binary file next to the xml,
+ * so that the next start doesn't need to build the whole DOM. The file
+ * begins with a key made of the xml size, mtime and content hash, and
+ * is ignored and rewritten if any of them changes.
+ */
+
+static const char CACHE_MAGIC[8] = { 'D','F','H','S','Y','M','C','1' };
+
+struct CacheWriter
+{
+    vector<char> data;
+
+    void put(const void *ptr, size_t size)
+    {
+        data.insert(data.end(), (const char*)ptr, (const char*)ptr + size);
+    }
+    void u32(uint32_t value) { put(&value, sizeof(value)); }
+    void str(const string &value)
+    {
+        u32(value.size());
+        put(value.data(), value.size());
+    }
+};
+
+struct CacheReader
+{
+    const char *pos, *end;
+    bool ok;
+
+    CacheReader(const char *pos, const char *end) : pos(pos), end(end), ok(true) {}
+
+    bool get(void *ptr, size_t size)
+    {
+        if (!ok || size_t(end - pos) < size)
+            return ok = false;
+        memcpy(ptr, pos, size);
+        pos += size;
+        return true;
+    }
+    uint32_t u32()
+    {
+        uint32_t value = 0;
+        get(&value, sizeof(value));
+        return value;
+    }
+    string str()
+    {
+        uint32_t size = u32();
+        if (!ok || size_t(end - pos) < size)
+        {
+            ok = false;
+            return string();
+        }
+        string value(pos, size);
+        pos += size;
+        return value;
+    }
+};
+
+// 64-bit FNV-1a of the file contents
+static bool hash_file(const string &path, uint64_t &size, uint64_t &hash)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    vector<unsigned char> buf(64*1024);
+    size_t count;
+
+    size = 0;
+    hash = 14695981039346656037ULL;
+
+    while ((count = fread(&buf[0], 1, buf.size(), f)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+            hash = (hash ^ buf[i]) * 1099511628211ULL;
+        size += count;
+    }
+
+    fclose(f);
+    return true;
+}
+
+bool VersionInfoFactory::loadCache(string path_to_cache, const vector<char> &key)
+{
+    FILE *f = fopen(path_to_cache.c_str(), "rb");
+    if (!f)
+        return false;
+
+    vector<char> data;
+    if (fseek(f, 0, SEEK_END) == 0)
+    {
+        long size = ftell(f);
+        if (size > 0 && fseek(f, 0, SEEK_SET) == 0)
+        {
+            data.resize(size);
+            if (fread(&data[0], 1, size, f) != size_t(size))
+                data.clear();
+        }
+    }
+    fclose(f);
+
+    if (data.size() < key.size() || memcmp(&data[0], &key[0], key.size()) != 0)
+        return false;
+
+    clear();
+
+    CacheReader in(&data[0] + key.size(), &data[0] + data.size());
+    uint32_t count = in.u32();
+
+    for (uint32_t i = 0; i < count && in.ok; i++)
+    {
+        VersionInfo *version = new VersionInfo();
+        versions.push_back(version);
+
+        version->version = in.str();
+        version->OS = (OSType)in.u32();
+        version->base = in.u32();
+
+        uint32_t n = in.u32();
+        for (uint32_t j = 0; j < n && in.ok; j++)
+            version->md5_list.push_back(in.str());
+
+        n = in.u32();
+        for (uint32_t j = 0; j < n && in.ok; j++)
+            version->PE_list.push_back(in.u32());
+
+        n = in.u32();
+        for (uint32_t j = 0; j < n && in.ok; j++)
+        {
+            string name = in.str();
+            version->Addresses.insert(version->Addresses.end(), make_pair(name, in.u32()));
+        }
+
+        n = in.u32();
+        for (uint32_t j = 0; j < n && in.ok; j++)
+        {
+            string name = in.str();
+            version->VTables.insert(version->VTables.end(), make_pair(name, in.u32()));
+        }
+    }
+
+    if (!in.ok || in.pos != in.end)
+    {
+        cerr << "Ignoring damaged symbol cache " << path_to_cache << endl;
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+void VersionInfoFactory::saveCache(string path_to_cache, const vector<char> &key)
+{
+    CacheWriter out;
+    out.put(&key[0], key.size());
+    out.u32(versions.size());
+
+    for (size_t i = 0; i < versions.size(); i++)
+    {
+        VersionInfo *version = versions[i];
+
+        out.str(version->version);
+        out.u32(version->OS);
+        out.u32(version->base);
+
+        out.u32(version->md5_list.size());
+        for (size_t j = 0; j < version->md5_list.size(); j++)
+            out.str(version->md5_list[j]);
+
+        out.u32(version->PE_list.size());
+        for (size_t j = 0; j < version->PE_list.size(); j++)
+            out.u32(version->PE_list[j]);
+
+        out.u32(version->Addresses.size());
+        for (auto it = version->Addresses.begin(); it != version->Addresses.end(); ++it)
+        {
+            out.str(it->first);
+            out.u32(it->second);
+        }
+
+        out.u32(version->VTables.size());
+        for (auto it = version->VTables.begin(); it != version->VTables.end(); ++it)
+        {
+            out.str(it->first);
+            out.u32(it->second);
+        }
+    }
+
+    // write to a temporary name first, so that a crash can't leave half a cache
+    string tmp_path = path_to_cache + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f)
+        return;
+
+    bool ok = (fwrite(&out.data[0], 1, out.data.size(), f) == out.data.size());
+    ok = (fclose(f) == 0) && ok;
+
+    remove(path_to_cache.c_str());
+    if (!ok || rename(tmp_path.c_str(), path_to_cache.c_str()) != 0)
+    {
+        remove(tmp_path.c_str());
+        cerr << "Could not write symbol cache " << path_to_cache << endl;
+    }
+}
+
 bool VersionInfoFactory::loadFile(string path_to_xml)
+{
+    string path_to_cache = path_to_xml + ".cache";
+
+    // key the cache by the xml size, mtime and contents
+    vector<char> key;
+    STAT_STRUCT info;
+    uint64_t size, hash;
+
+    if (Filesystem::stat(path_to_xml, info) && hash_file(path_to_xml, size, hash))
+    {
+        int64_t mtime = info.st_mtime;
+        key.insert(key.end(), CACHE_MAGIC, CACHE_MAGIC + sizeof(CACHE_MAGIC));
+        key.insert(key.end(), (char*)&size, (char*)&size + sizeof(size));
+        key.insert(key.end(), (char*)&mtime, (char*)&mtime + sizeof(mtime));
+        key.insert(key.end(), (char*)&hash, (char*)&hash + sizeof(hash));
+
+        if (loadCache(path_to_cache, key))
+        {
+            error = false;
+            buildIndex();
+            std::cerr << "Loaded " << versions.size() << " DF symbol tables from "
+                      << path_to_cache << "." << std::endl;
+            return true;
+        }
+    }
+
+    loadXML(path_to_xml);
+
+    if (!key.empty())
+        saveCache(path_to_cache, key);
+
+    buildIndex();
+    return true;
+}
+
+// load the XML file with offsets
+bool VersionInfoFactory::loadXML(string path_to_xml)
 {
     TiXmlDocument doc( path_to_xml.c_str() );
     std::cerr << "Loading " << path_to_xml << " ... ";
@@ -0,0 +1,212 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+// Library hot paths timed by both devel/benchmark and dfhack-bench
+
+#include "Benchmarks.h"
+
+#include "DataDefs.h"
+#include "LuaTools.h"
+#include "TileTypes.h"
+#include "RemoteTools.h"
+#include "BasicApi.pb.h"
+
+#include "modules/Maps.h"
+#include "modules/MapCache.h"
+#include "modules/Translation.h"
+
+#include "df/world.h"
+#include "df/unit.h"
+
+#include <ctime>
+
+using std::string;
+
+using namespace DFHack;
+using namespace DFHack::Benchmarks;
+using namespace df::enums;
+
+using df::global::world;
+
+volatile int Benchmarks::sink = 0;
+
+static size_t bench_mapcache(color_ostream &out, lua_State *L)
+{
+    uint32_t x_max, y_max, z_max;
+    Maps::getSize(x_max, y_max, z_max);
+
+    MapExtras::MapCache mc;
+    size_t count = 0;
+    int sum = 0;
+
+    for (uint32_t z = 0; z < z_max; z++)
+    {
+        for (uint32_t by = 0; by < y_max; by++)
+        {
+            for (uint32_t bx = 0; bx < x_max; bx++)
+            {
+                MapExtras::Block *b = mc.BlockAt(DFCoord(bx, by, z));
+                if (!b || !b->is_valid())
+                    continue;
+
+                for (int y = 0; y < 16; y++)
+                {
+                    for (int x = 0; x < 16; x++)
+                    {
+                        df::coord2d pos(x, y);
+                        sum += b->tiletypeAt(pos) + b->veinMaterialAt(pos).mat_subtype;
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+
+    sink += sum;
+    return count;
+}
+
+static size_t bench_similar_tiletype(color_ostream &out, lua_State *L)
+{
+    size_t count = 0;
+    int sum = 0;
+
+    FOR_ENUM_ITEMS(tiletype, tt)
+    {
+        if (tileShape(tt) == tiletype_shape::NONE)
+            continue;
+
+        FOR_ENUM_ITEMS(tiletype_shape, shape)
+        {
+            if (shape == tiletype_shape::NONE)
+                continue;
+
+            sum += findSimilarTileType(tt, shape);
+            count++;
+        }
+    }
+
+    sink += sum;
+    return count;
+}
+
+static size_t bench_translate_name(color_ostream &out, lua_State *L)
+{
+    size_t count = 0;
+    size_t len = 0;
+
+    for (size_t i = 0; i < world->units.all.size(); i++)
+    {
+        df::unit *unit = world->units.all[i];
+        if (!unit->name.has_name)
+            continue;
+
+        len += Translation::TranslateName(&unit->name, false).size();
+        len += Translation::TranslateName(&unit->name, true).size();
+        count += 2;
+    }
+
+    sink += len;
+    return count;
+}
+
+// the same, but every name is built from the raws again
+static size_t bench_translate_name_cold(color_ostream &out, lua_State *L)
+{
+    Translation::ClearCache();
+    return bench_translate_name(out, L);
+}
+
+static size_t bench_lua_fields(color_ostream &out, lua_State *L)
+{
+    Lua::StackUnwinder top(L);
+
+    static const char *code =
+        "local world = ...\n"
+        "local sum, count = 0, 0\n"
+        "for _,u in ipairs(world.units.all) do\n"
+        "  sum = sum + u.id + u.civ_id + u.pos.x + u.pos.y + u.pos.z\n"
+        "  count = count + 5\n"
+        "end\n"
+        "for _,b in ipairs(world.map.map_blocks) do\n"
+        "  sum = sum + b.map_pos.x + b.map_pos.y + b.designation[0][0].geolayer_index\n"
+        "  count = count + 3\n"
+        "end\n"
+        "return count, sum\n";
+
+    Lua::PushDFObject(L, world);
+
+    if (!Lua::SafeCallString(out, L, code, 1, 2, true, "=(benchmark)"))
+        return 0;
+
+    sink += lua_tointeger(L, -1);
+    return lua_tointeger(L, -2);
+}
+
+static size_t bench_rpc_units(color_ostream &out, lua_State *L)
+{
+    dfproto::ListUnitsOut reply;
+    dfproto::BasicUnitInfoMask mask;
+    mask.set_labors(true);
+    mask.set_skills(true);
+    mask.set_profession(true);
+    mask.set_misc_traits(true);
+
+    for (size_t i = 0; i < world->units.all.size(); i++)
+        describeUnit(reply.add_value(), world->units.all[i], &mask);
+
+    string data;
+    reply.SerializeToString(&data);
+
+    dfproto::ListUnitsOut decoded;
+    if (!decoded.ParseFromString(data))
+    {
+        out.printerr("Could not decode the encoded unit list.\n");
+        return 0;
+    }
+
+    sink += decoded.value_size();
+    return world->units.all.size();
+}
+
+const Benchmark Benchmarks::list[] = {
+    { "mapcache", bench_mapcache, true },
+    { "similar-tiletype", bench_similar_tiletype, false },
+    { "translate-name", bench_translate_name, false },
+    { "translate-name-cold", bench_translate_name_cold, false },
+    { "lua-fields", bench_lua_fields, false },
+    { "rpc-units", bench_rpc_units, false },
+    { NULL, NULL, false }
+};
+
+void Benchmarks::logResult(std::ofstream &log, const string &game_version, const string &name,
+                           int iterations, size_t items, uint32_t total_ms)
+{
+    if (!log.is_open())
+        return;
+
+    log << (long)time(NULL) << '\t' << DFHACK_VERSION << '\t' << game_version << '\t'
+        << name << '\t' << iterations << '\t' << items << '\t'
+        << total_ms << std::endl;
+}
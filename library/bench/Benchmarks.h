@@ -0,0 +1,61 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+#pragma once
+
+#include "ColorText.h"
+
+#include <string>
+#include <fstream>
+
+struct lua_State;
+
+namespace DFHack
+{
+namespace Benchmarks
+{
+    /**
+     * Runs one iteration against df::global::world, and returns the
+     * number of items processed. L is used by the Lua benchmarks.
+     */
+    typedef size_t (*bench_fn)(color_ostream &out, lua_State *L);
+
+    struct Benchmark
+    {
+        const char *name;
+        bench_fn fn;
+        bool need_map;
+    };
+
+    /// Benchmarks shared by devel/benchmark and dfhack-bench, ending with a NULL name.
+    extern const Benchmark list[];
+
+    /// Append a tab-separated result line, if the log is open.
+    void logResult(std::ofstream &log, const std::string &game_version, const std::string &name,
+                   int iterations, size_t items, uint32_t total_ms);
+
+    /// Keeps the compiler from dropping the benchmarked reads.
+    extern volatile int sink;
+}
+}
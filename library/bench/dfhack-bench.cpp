@@ -0,0 +1,218 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+// Times library hot paths against a synthetic world, without DF running.
+// The result lines have the same columns as those of devel/benchmark.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Benchmarks.h"
+#include "WorldFixture.h"
+
+#include "Core.h"
+#include "DataDefs.h"
+#include "LuaTools.h"
+#include "modules/EventManager.h"
+
+#include "df/world.h"
+
+using std::string;
+using std::vector;
+
+using namespace DFHack;
+using namespace DFHack::Benchmarks;
+
+static Fixture::SyntheticWorld *fixture = NULL;
+static int job_count = 500;
+
+static size_t events_seen = 0;
+
+static void onEvent(color_ostream &out, void *ptr)
+{
+    events_seen++;
+}
+
+static void initEventManager(color_ostream &out)
+{
+    using namespace EventManager;
+
+    // what Core does on loading a fort; the event state is read from the world
+    onStateChange(out, SC_MAP_LOADED);
+
+    EventHandler handler(onEvent, 1);
+    registerListener(EventType::JOB_INITIATED, handler, NULL);
+    registerListener(EventType::JOB_COMPLETED, handler, NULL);
+    registerListener(EventType::UNIT_DEATH, handler, NULL);
+}
+
+// One game tick: jobs finish and new ones are posted, then the events are
+// dispatched under the suspend lock, as from Core::Update.
+static size_t bench_event_manager(color_ostream &out, lua_State *L)
+{
+    fixture->tick();
+
+    CoreSuspendClaimer suspend(true);
+    EventManager::manageEvents(out);
+
+    sink += events_seen;
+    return job_count;
+}
+
+static const Benchmark standalone[] = {
+    { "event-manager", bench_event_manager, false },
+    { NULL, NULL, false }
+};
+
+static uint32_t getTimeMs()
+{
+    return uint32_t(uint64_t(clock()) * 1000 / CLOCKS_PER_SEC);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "Usage: dfhack-bench [-n iterations] [-o file] [-map blocks] [-units count]\n"
+        "                    [-jobs count] [name...]\n"
+        "  Runs each benchmark (or only the named ones) the given number of\n"
+        "  times, 10 by default, after one untimed warm-up run, against a\n"
+        "  synthetic map of blocks x blocks map blocks (12 by default), with\n"
+        "  the given number of units (1000) and jobs (500).\n"
+        "  Benchmarks: mapcache, similar-tiletype, translate-name,\n"
+        "  translate-name-cold, lua-fields, rpc-units, event-manager.\n"
+        "  With -o, appends one tab-separated line per benchmark to the\n"
+        "  file: time, dfhack version, 'synthetic', name, iterations,\n"
+        "  items per iteration, total milliseconds.\n");
+}
+
+static void runBenchmarks(color_ostream &out, lua_State *L, std::ofstream &log,
+                          const Benchmark *table, const vector<string> &selected, int iterations)
+{
+    for (const Benchmark *bench = table; bench->name; bench++)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), bench->name) == selected.end())
+            continue;
+
+        // warm up caches before timing
+        size_t items = bench->fn(out, L);
+
+        uint32_t start = getTimeMs();
+        for (int i = 0; i < iterations; i++)
+            bench->fn(out, L);
+        uint32_t total = getTimeMs() - start;
+
+        printf("%-20s %d x %d items: %u ms (%.3f ms per iteration)\n",
+               bench->name, iterations, int(items), total, double(total) / iterations);
+
+        logResult(log, "synthetic", bench->name, iterations, items, total);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    int iterations = 10;
+    int map_size = 12;
+    int unit_count = 1000;
+    string outfile;
+    vector<string> selected;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i+1 < argc)
+            iterations = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i+1 < argc)
+            outfile = argv[++i];
+        else if (!strcmp(argv[i], "-map") && i+1 < argc)
+            map_size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-units") && i+1 < argc)
+            unit_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-jobs") && i+1 < argc)
+            job_count = atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            selected.push_back(argv[i]);
+    }
+
+    if (iterations <= 0 || map_size <= 0 || unit_count < 0 || job_count < 0)
+    {
+        usage();
+        return 2;
+    }
+
+    std::ofstream log;
+    if (!outfile.empty())
+    {
+        log.open(outfile.c_str(), std::ios::out | std::ios::app);
+        if (!log.good())
+        {
+            fprintf(stderr, "Could not open %s\n", outfile.c_str());
+            return 2;
+        }
+    }
+
+    color_ostream_wrapper out(std::cout);
+
+    Fixture::SyntheticWorld world;
+    fixture = &world;
+
+    Fixture::MapParams map_params;
+    map_params.x_blocks = map_params.y_blocks = map_size;
+    world.buildMap(map_params);
+    world.buildLanguage();
+
+    Fixture::UnitParams unit_params;
+    unit_params.count = unit_count;
+    world.buildUnits(unit_params);
+
+    Fixture::JobParams job_params;
+    job_params.count = job_count;
+    world.buildJobs(job_params);
+
+    initEventManager(out);
+
+    // dfhack.lua is not on the path here and field access does not need
+    // it, so the error from loading it is thrown away
+    buffered_color_ostream lua_out;
+    lua_State *L = Lua::Open(lua_out);
+
+    runBenchmarks(out, L, log, Benchmarks::list, selected, iterations);
+    runBenchmarks(out, L, log, standalone, selected, iterations);
+
+    lua_close(L);
+
+    EventManager::onStateChange(out, SC_MAP_UNLOADED);
+    fixture = NULL;
+    return 0;
+}
@@ -0,0 +1,537 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+#include "WorldFixture.h"
+
+#include "DataDefs.h"
+#include "Error.h"
+#include "TileTypes.h"
+#include "MiscUtils.h"
+#include "modules/Job.h"
+#include "modules/Translation.h"
+
+#include "df/global_objects.h"
+#include "df/world.h"
+#include "df/map_block.h"
+#include "df/mineral_cluster.h"
+#include "df/language_word.h"
+#include "df/language_translation.h"
+#include "df/language_name.h"
+#include "df/unit.h"
+#include "df/unit_skill.h"
+#include "df/unit_misc_trait.h"
+#include "df/job.h"
+#include "df/job_list_link.h"
+
+#include <cstdio>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+using namespace DFHack;
+using namespace DFHack::Fixture;
+using namespace df::enums;
+
+// Small LCG, so that fixtures come out the same on every platform
+static uint32_t nextRandom(uint32_t &state, uint32_t max)
+{
+    state = state * 1103515245 + 12345;
+    return max ? (state >> 8) % max : 0;
+}
+
+static vector<df::tiletype> findTiletypes(df::tiletype_shape shape, df::tiletype_material mat)
+{
+    vector<df::tiletype> rv;
+    FOR_ENUM_ITEMS(tiletype, tt)
+    {
+        if (tileShape(tt) == shape && tileMaterial(tt) == mat)
+            rv.push_back(tt);
+    }
+    return rv;
+}
+
+// One layer material per geolayer_index
+template<class T, size_t N>
+static void setStoneTypes(T (&layers)[N], int mat)
+{
+    for (size_t i = 0; i < N; i++)
+        layers[i] = mat;
+}
+
+template<class T>
+static void setStoneTypes(vector<T> &layers, int mat)
+{
+    layers.assign(16, mat);
+}
+
+SyntheticWorld::SyntheticWorld()
+    : job_next_id(1), item_next_id(1), building_next_id(1),
+      cur_year(100), cur_year_tick(0), job_rng(1), max_job_duration(50)
+{
+    world = new df::world();
+
+    old_world = df::global::world;
+    old_job_next_id = df::global::job_next_id;
+    old_item_next_id = df::global::item_next_id;
+    old_building_next_id = df::global::building_next_id;
+    old_cur_year = df::global::cur_year;
+    old_cur_year_tick = df::global::cur_year_tick;
+
+    df::global::world = world;
+    df::global::job_next_id = &job_next_id;
+    df::global::item_next_id = &item_next_id;
+    df::global::building_next_id = &building_next_id;
+    df::global::cur_year = &cur_year;
+    df::global::cur_year_tick = &cur_year_tick;
+}
+
+SyntheticWorld::~SyntheticWorld()
+{
+    clearJobs();
+    clearUnits();
+    clearMap();
+    clearLanguage();
+
+    if (df::global::world == world)
+    {
+        df::global::world = old_world;
+        df::global::job_next_id = old_job_next_id;
+        df::global::item_next_id = old_item_next_id;
+        df::global::building_next_id = old_building_next_id;
+        df::global::cur_year = old_cur_year;
+        df::global::cur_year_tick = old_cur_year_tick;
+    }
+    delete world;
+}
+
+void SyntheticWorld::clearMap()
+{
+    auto &map = world->map;
+
+    if (map.block_index)
+    {
+        for (int x = 0; x < map.x_count_block; x++)
+        {
+            for (int y = 0; y < map.y_count_block; y++)
+                delete[] map.block_index[x][y];
+            delete[] map.block_index[x];
+        }
+        delete[] map.block_index;
+        map.block_index = NULL;
+    }
+
+    map.map_blocks.clear();
+    map.x_count_block = map.y_count_block = map.z_count_block = 0;
+    map.x_count = map.y_count = map.z_count = 0;
+
+    for (size_t i = 0; i < blocks.size(); i++)
+        delete blocks[i];
+    blocks.clear();
+
+    world->gem_clusters.clear();
+    world->stone_clusters.clear();
+
+    for (size_t i = 0; i < clusters.size(); i++)
+        delete clusters[i];
+    clusters.clear();
+}
+
+void SyntheticWorld::buildMap(const MapParams &params)
+{
+    clearMap();
+
+    auto &map = world->map;
+    uint32_t rng = params.seed;
+
+    vector<df::tiletype> floors = findTiletypes(tiletype_shape::FLOOR, tiletype_material::STONE);
+    vector<df::tiletype> walls = findTiletypes(tiletype_shape::WALL, tiletype_material::STONE);
+
+    // vein kinds, picked with equal chance
+    static const df::tiletype_material vein_mats[] = {
+        tiletype_material::ORE, tiletype_material::GEM,
+        tiletype_material::STONE_LIGHT, tiletype_material::STONE_DARK
+    };
+    vector<df::tiletype> veins[4];
+    for (int i = 0; i < 4; i++)
+        veins[i] = findTiletypes(tiletype_shape::WALL, vein_mats[i]);
+
+    setStoneTypes(map.stone_types, 0);
+    world->raws.lava_stone = 0;
+    world->raws.river_stone = 0;
+
+    map.x_count_block = params.x_blocks;
+    map.y_count_block = params.y_blocks;
+    map.z_count_block = params.z_levels;
+    map.x_count = params.x_blocks * 16;
+    map.y_count = params.y_blocks * 16;
+    map.z_count = params.z_levels;
+
+    map.block_index = new df::map_block ***[params.x_blocks];
+
+    for (int bx = 0; bx < params.x_blocks; bx++)
+    {
+        map.block_index[bx] = new df::map_block **[params.y_blocks];
+
+        for (int by = 0; by < params.y_blocks; by++)
+        {
+            map.block_index[bx][by] = new df::map_block *[params.z_levels];
+
+            for (int z = 0; z < params.z_levels; z++)
+            {
+                df::map_block *blk = new df::map_block();
+                blk->flags.resize(1);
+                blk->map_pos.x = bx * 16;
+                blk->map_pos.y = by * 16;
+                blk->map_pos.z = z;
+
+                for (int tx = 0; tx < 16; tx++)
+                {
+                    for (int ty = 0; ty < 16; ty++)
+                    {
+                        df::tiletype tt = tiletype::Void;
+                        int kind = -1;
+
+                        if (nextRandom(rng, 100) < uint32_t(params.open_percent))
+                        {
+                            if (!floors.empty())
+                                tt = floors[nextRandom(rng, floors.size())];
+                        }
+                        else if (nextRandom(rng, 100) < uint32_t(params.vein_percent))
+                        {
+                            kind = nextRandom(rng, 4);
+                            if (!veins[kind].empty())
+                                tt = veins[kind][nextRandom(rng, veins[kind].size())];
+                        }
+                        else if (!walls.empty())
+                            tt = walls[nextRandom(rng, walls.size())];
+
+                        convertTile(tt, blk->chr[tx][ty], blk->color[tx][ty]);
+                        blk->designation[tx][ty].bits.geolayer_index = nextRandom(rng, 16);
+                        blk->temperature_1[tx][ty] = 10015;
+                        blk->temperature_2[tx][ty] = 10015;
+
+                        // gem and light/dark stone veins get their
+                        // material from a cluster covering the tile
+                        if (kind == 1 || kind == 2 || kind == 3)
+                        {
+                            auto cluster = new df::mineral_cluster();
+                            cluster->z = z;
+                            cluster->x1 = cluster->x2 = bx * 16 + tx;
+                            cluster->y1 = cluster->y2 = by * 16 + ty;
+                            cluster->color = blk->color[tx][ty].bits.color & 7;
+                            cluster->matgloss = nextRandom(rng, 8);
+                            clusters.push_back(cluster);
+
+                            if (kind == 1)
+                            {
+                                cluster->material = material_type::GEM_ORNAMENTAL;
+                                world->gem_clusters.push_back(cluster);
+                            }
+                            else
+                            {
+                                cluster->material = (kind == 2) ? material_type::STONE_LIGHT
+                                                                : material_type::STONE_DARK;
+                                world->stone_clusters.push_back(cluster);
+                            }
+                        }
+                    }
+                }
+
+                map.block_index[bx][by][z] = blk;
+                map.map_blocks.push_back(blk);
+                blocks.push_back(blk);
+            }
+        }
+    }
+}
+
+void SyntheticWorld::clearLanguage()
+{
+    auto &language = world->raws.language;
+    language.words.clear();
+    language.translations.clear();
+
+    for (size_t i = 0; i < words.size(); i++)
+        delete words[i];
+    words.clear();
+
+    for (size_t i = 0; i < translations.size(); i++)
+        delete translations[i];
+    translations.clear();
+
+    for (size_t i = 0; i < spellings.size(); i++)
+        delete spellings[i];
+    spellings.clear();
+
+    Translation::ClearCache();
+}
+
+static string makeSyllables(uint32_t &rng, int count)
+{
+    static const char *const syllables[] = {
+        "ab", "ber", "dor", "ek", "gol", "ith", "kad", "lun",
+        "mor", "nal", "ost", "rak", "sed", "tum", "ur", "zan"
+    };
+
+    string rv;
+    for (int i = 0; i < count; i++)
+        rv += syllables[nextRandom(rng, 16)];
+    return rv;
+}
+
+void SyntheticWorld::buildLanguage(const LanguageParams &params)
+{
+    clearLanguage();
+
+    auto &language = world->raws.language;
+    uint32_t rng = params.seed;
+    char buf[32];
+
+    for (int i = 0; i < params.words; i++)
+    {
+        auto word = new df::language_word();
+        sprintf(buf, "WORD%d", i);
+        word->word = buf;
+
+        string base = makeSyllables(rng, 1 + nextRandom(rng, 3));
+        FOR_ENUM_ITEMS(part_of_speech, pos)
+        {
+            sprintf(buf, "%s%d", base.c_str(), int(pos));
+            word->forms[pos] = buf;
+        }
+
+        words.push_back(word);
+        language.words.push_back(word);
+    }
+
+    for (int i = 0; i < params.translations; i++)
+    {
+        auto trans = new df::language_translation();
+
+        for (int j = 0; j < params.words; j++)
+        {
+            auto spelling = new string(makeSyllables(rng, 1 + nextRandom(rng, 2)));
+            spellings.push_back(spelling);
+            trans->words.push_back(spelling);
+        }
+
+        translations.push_back(trans);
+        language.translations.push_back(trans);
+    }
+}
+
+void SyntheticWorld::makeName(df::language_name *name, uint32_t seed)
+{
+    CHECK_NULL_POINTER(name);
+
+    *name = df::language_name();
+
+    auto &language = world->raws.language;
+    if (language.words.empty() || language.translations.empty())
+        return;
+
+    uint32_t rng = seed;
+    name->has_name = true;
+    name->language = nextRandom(rng, language.translations.size());
+    name->first_name = makeSyllables(rng, 2);
+
+    // the first two parts, some of the middle ones and the last two
+    for (int i = 0; i < 7; i++)
+    {
+        if (i >= 2 && i <= 4 && nextRandom(rng, 2))
+            continue;
+
+        name->parts[i].word = nextRandom(rng, language.words.size());
+        name->parts[i].part_of_speech =
+            df::part_of_speech(nextRandom(rng, ENUM_LAST_ITEM(part_of_speech) + 1));
+    }
+}
+
+void SyntheticWorld::clearUnits()
+{
+    world->units.all.clear();
+    world->units.active.clear();
+
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        df::unit *unit = units[i];
+        for (size_t j = 0; j < unit->status.skills.size(); j++)
+            delete unit->status.skills[j];
+        for (size_t j = 0; j < unit->status.misc_traits.size(); j++)
+            delete unit->status.misc_traits[j];
+        delete unit;
+    }
+    units.clear();
+}
+
+void SyntheticWorld::buildUnits(const UnitParams &params)
+{
+    clearUnits();
+
+    auto &map = world->map;
+    uint32_t rng = params.seed;
+    int num_labors = sizeof(((df::unit*)NULL)->status.labors)/sizeof(bool);
+
+    for (int i = 0; i < params.count; i++)
+    {
+        auto unit = new df::unit();
+        unit->id = i + 1;
+
+        if (map.block_index)
+        {
+            unit->pos.x = nextRandom(rng, map.x_count);
+            unit->pos.y = nextRandom(rng, map.y_count);
+            unit->pos.z = nextRandom(rng, map.z_count);
+        }
+        else
+            unit->pos.x = unit->pos.y = unit->pos.z = 0;
+
+        makeName(&unit->name, params.seed + i + 1);
+
+        unit->race = nextRandom(rng, params.races);
+        unit->sex = nextRandom(rng, 2);
+        unit->civ_id = 1;
+        unit->hist_figure_id = -1;
+        unit->profession = df::profession(nextRandom(rng, ENUM_LAST_ITEM(profession) + 1));
+        unit->flags1.bits.dead = (nextRandom(rng, 100) < uint32_t(params.dead_percent));
+
+        for (int j = 0; j < num_labors; j++)
+            unit->status.labors[j] = (nextRandom(rng, 4) == 0);
+
+        // skills are kept sorted by id, like the game does
+        int skill_id = 0;
+        for (int j = 0; j < params.skills && skill_id <= ENUM_LAST_ITEM(job_skill); j++)
+        {
+            auto skill = new df::unit_skill();
+            skill->id = df::job_skill(skill_id);
+            skill->rating = df::skill_rating(nextRandom(rng, 16));
+            skill->experience = nextRandom(rng, 500);
+            unit->status.skills.push_back(skill);
+
+            skill_id += 1 + nextRandom(rng, 3);
+        }
+
+        for (int j = 0; j < 3; j++)
+        {
+            auto trait = new df::unit_misc_trait();
+            trait->id = df::misc_trait_type(nextRandom(rng, ENUM_LAST_ITEM(misc_trait_type) + 1));
+            trait->value = nextRandom(rng, 1000);
+            unit->status.misc_traits.push_back(trait);
+        }
+
+        units.push_back(unit);
+        world->units.all.push_back(unit);
+        if (!unit->flags1.bits.dead)
+            world->units.active.push_back(unit);
+    }
+}
+
+void SyntheticWorld::clearJobs()
+{
+    while (world->job_list.next)
+        removeJob(world->job_list.next->item);
+}
+
+void SyntheticWorld::buildJobs(const JobParams &params)
+{
+    clearJobs();
+
+    job_rng = params.seed;
+    max_job_duration = std::max(1, params.max_duration);
+
+    df::job_list_link *tail = &world->job_list;
+    for (int i = 0; i < params.count; i++)
+        tail = linkJob(tail, 1 + nextRandom(job_rng, max_job_duration));
+}
+
+df::job_list_link *SyntheticWorld::linkJob(df::job_list_link *tail, int completion_timer)
+{
+    auto job = new df::job();
+    job->id = job_next_id++;
+    job->job_type = df::job_type(nextRandom(job_rng, ENUM_LAST_ITEM(job_type) + 1));
+    job->completion_timer = completion_timer;
+
+    job->list_link = new df::job_list_link();
+    job->list_link->item = job;
+    return linked_list_insert_after(tail, job->list_link);
+}
+
+df::job *SyntheticWorld::addJob(int completion_timer)
+{
+    df::job_list_link *tail = &world->job_list;
+    while (tail->next)
+        tail = tail->next;
+
+    return linkJob(tail, completion_timer)->item;
+}
+
+void SyntheticWorld::removeJob(df::job *job)
+{
+    CHECK_NULL_POINTER(job);
+
+    auto link = job->list_link;
+    if (link)
+    {
+        link->prev->next = link->next;
+        if (link->next)
+            link->next->prev = link->prev;
+        job->list_link = NULL;
+        delete link;
+    }
+
+    Job::deleteJobStruct(job, true);
+}
+
+void SyntheticWorld::tick()
+{
+    world->frame_counter++;
+    if (++cur_year_tick >= 403200) // ticks per year
+    {
+        cur_year_tick = 0;
+        cur_year++;
+    }
+
+    int finished = 0;
+    df::job_list_link *tail = &world->job_list;
+
+    while (tail->next)
+    {
+        df::job *job = tail->next->item;
+
+        if (job->completion_timer == 0)
+        {
+            removeJob(job);
+            finished++;
+            continue;
+        }
+
+        if (job->completion_timer > 0)
+            job->completion_timer--;
+        tail = tail->next;
+    }
+
+    for (int i = 0; i < finished; i++)
+        tail = linkJob(tail, 1 + nextRandom(job_rng, max_job_duration));
+}
@@ -0,0 +1,175 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+#pragma once
+
+#include "Export.h"
+#include "DataDefs.h"
+
+#include <string>
+#include <vector>
+
+namespace df
+{
+    struct world;
+    struct map_block;
+    struct mineral_cluster;
+    struct language_word;
+    struct language_translation;
+    struct language_name;
+    struct unit;
+    struct job;
+    struct job_list_link;
+}
+
+namespace DFHack
+{
+namespace Fixture
+{
+    /**
+     * Shape of the generated map. Wall tiles are layer stone, and the
+     * given fraction of them is turned into ore, gem and light/dark stone
+     * veins, with a mineral cluster for each gem and stone vein.
+     */
+    struct MapParams
+    {
+        int x_blocks, y_blocks, z_levels;
+        int open_percent;   // floor tiles among all tiles
+        int vein_percent;   // vein tiles among wall tiles
+        uint32_t seed;
+
+        MapParams()
+            : x_blocks(12), y_blocks(12), z_levels(1),
+              open_percent(30), vein_percent(8), seed(1) {}
+    };
+
+    /**
+     * Size of the generated language raws: every word has all its forms,
+     * and every translation has a native spelling of every word.
+     */
+    struct LanguageParams
+    {
+        int words, translations;
+        uint32_t seed;
+
+        LanguageParams() : words(2000), translations(4), seed(1) {}
+    };
+
+    /**
+     * Units in units.all, sorted by id, with the living ones also in
+     * units.active. Each gets a name in the generated language, a
+     * position on the map, random labors and skills, and a few misc traits.
+     */
+    struct UnitParams
+    {
+        int count;
+        int races;          // race ids are drawn from 0..races-1
+        int skills;         // skills per unit
+        int dead_percent;
+        uint32_t seed;
+
+        UnitParams() : count(200), races(8), skills(10), dead_percent(5), seed(1) {}
+    };
+
+    /**
+     * Jobs linked into world->job_list with ids from job_next_id. Each
+     * finishes after a random number of ticks, see SyntheticWorld::tick.
+     */
+    struct JobParams
+    {
+        int count;
+        int max_duration;   // ticks until a job is done
+        uint32_t seed;
+
+        JobParams() : count(100), max_duration(50), seed(1) {}
+    };
+
+    /**
+     * A df::world built in process memory, for running library code
+     * without the game. While it exists, df::global::world and the
+     * job_next_id, item_next_id, building_next_id, cur_year and
+     * cur_year_tick globals point into it.
+     *
+     * Generated: the map block grid, the language raws, units and the
+     * job list. Items and buildings are left empty, and so are unit
+     * inventories: df::item and df::building are classes with virtual
+     * methods, and their vtables only exist in the game binary.
+     */
+    class SyntheticWorld
+    {
+    public:
+        SyntheticWorld();
+        ~SyntheticWorld();
+
+        df::world *get() { return world; }
+
+        /// Replace the map with a new block grid.
+        void buildMap(const MapParams &params = MapParams());
+        /// Replace the language raws with new words and translations.
+        void buildLanguage(const LanguageParams &params = LanguageParams());
+        /// Replace the units. Call after buildMap and buildLanguage.
+        void buildUnits(const UnitParams &params = UnitParams());
+        /// Replace the job list.
+        void buildJobs(const JobParams &params = JobParams());
+
+        /// Advance the clock by one tick: finished jobs (completion_timer
+        /// 0) are removed and replaced by new ones, and the others count down.
+        void tick();
+
+        /// Fill in a random name using the generated language.
+        void makeName(df::language_name *name, uint32_t seed);
+
+        /// Link a new job into the job list, with the next job id.
+        df::job *addJob(int completion_timer);
+        /// Unlink a job from the job list and free it.
+        void removeJob(df::job *job);
+
+    private:
+        void clearMap();
+        void clearLanguage();
+        void clearUnits();
+        void clearJobs();
+        df::job_list_link *linkJob(df::job_list_link *tail, int completion_timer);
+
+        df::world *world;
+
+        int32_t job_next_id, item_next_id, building_next_id;
+        int32_t cur_year, cur_year_tick;
+        uint32_t job_rng;
+        int max_job_duration;
+
+        // the globals to put back on destruction
+        df::world *old_world;
+        int32_t *old_job_next_id, *old_item_next_id, *old_building_next_id;
+        int32_t *old_cur_year, *old_cur_year_tick;
+
+        std::vector<df::map_block*> blocks;
+        std::vector<df::mineral_cluster*> clusters;
+        std::vector<df::language_word*> words;
+        std::vector<df::language_translation*> translations;
+        std::vector<std::string*> spellings;
+        std::vector<df::unit*> units;
+    };
+}
+}
@@ -113,6 +113,10 @@ namespace DFHack
 
         int lua_item_count(lua_State *state, void *ptr, CountMode cnt);
 
+        void *get_item_pointer(type_identity *item, void *ptr, int idx) {
+            return item_pointer(item, ptr, idx);
+        }
+
         virtual void lua_item_reference(lua_State *state, int fname_idx, void *ptr, int idx);
         virtual void lua_item_read(lua_State *state, int fname_idx, void *ptr, int idx);
         virtual void lua_item_write(lua_State *state, int fname_idx, void *ptr, int idx, int val_index);
@@ -392,6 +392,19 @@ namespace DFHack {namespace Lua {
         }
     }
 
+    /**
+     * Pool of separate interpreters for code that runs on other threads
+     * without suspending the core, e.g. read-only RPC calls. They have
+     * the standard library, the dfhack output and error handling functions
+     * and dfhack.snapshot, but no df objects or other game data. A state
+     * belongs to one thread between Acquire and Release, and keeps its
+     * loaded modules when returned to the pool.
+     */
+    namespace Pool {
+        DFHACK_EXPORT lua_State *Acquire(color_ostream &out);
+        DFHACK_EXPORT void Release(lua_State *state);
+    }
+
     class DFHACK_EXPORT Notification : public Event::Owner {
         lua_State *state;
         void *key;
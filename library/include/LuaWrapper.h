@@ -81,6 +81,11 @@ namespace DFHack { namespace LuaWrapper {
 
     extern LuaToken DFHACK_EMPTY_TABLE_TOKEN;
 
+    /**
+     * Registry pkey: weak hash of address -> last object ref pushed for it.
+     */
+    extern LuaToken DFHACK_REF_CACHE_TOKEN;
+
 /*
  * Upvalue: contents of DFHACK_TYPETABLE_NAME
  */
@@ -130,6 +135,10 @@ namespace DFHack { namespace LuaWrapper {
      * Push the pointer as DF object ref using metatable on the stack.
      */
     void push_object_ref(lua_State *state, void *ptr);
+    /**
+     * Same, but may return an existing ref with the same address and metatable.
+     */
+    void push_cached_object_ref(lua_State *state, void *ptr);
     void *get_object_ref(lua_State *state, int val_index);
 
     /*
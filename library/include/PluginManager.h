@@ -119,6 +119,22 @@ namespace DFHack
         command_hotkey_guard guard;
         std::string usage;
     };
+    enum PluginUpdateFlags
+    {
+        /// count the interval in game ticks (world->frame_counter) instead of frames
+        UPDATE_TICKS = 1,
+        /// only call plugin_onupdate while the game is running
+        UPDATE_UNPAUSED = 2,
+        /// only call plugin_onupdate while the game is paused
+        UPDATE_PAUSED = 4
+    };
+    /// How often PluginManager calls plugin_onupdate; see DFHACK_PLUGIN_UPDATE_CADENCE.
+    /// May be changed by the plugin at any time.
+    struct PluginUpdateCadence
+    {
+        int interval;
+        int flags;
+    };
     class Plugin
     {
         struct RefLock;
@@ -206,6 +222,7 @@ namespace DFHack
         void reset_lua();
 
         bool *plugin_is_enabled;
+        PluginUpdateCadence *plugin_update_cadence;
         command_result (*plugin_init)(color_ostream &, std::vector <PluginCommand> &);
         command_result (*plugin_status)(color_ostream &, std::string &);
         command_result (*plugin_shutdown)(color_ostream &);
@@ -229,6 +246,8 @@ namespace DFHack
         void OnStateChange(color_ostream &out, state_change_event event);
         void registerCommands( Plugin * p );
         void unregisterCommands( Plugin * p );
+        void addUpdateHook( Plugin * p );
+        void removeUpdateHook( Plugin * p );
     // PUBLIC METHODS
     public:
         Plugin *getPluginByName (const std::string & name);
@@ -252,6 +271,9 @@ namespace DFHack
         std::map <std::string, Plugin *> belongs;
         std::vector <Plugin *> all_plugins;
         std::string plugin_path;
+        // plugins with plugin_onupdate, and the clocks of their schedules
+        std::vector <Plugin *> update_plugins;
+        uint32_t update_frame, update_tick, last_frame_counter, next_update_phase;
     };
 
     namespace Gui
@@ -273,6 +295,12 @@ namespace DFHack
     DFhackDataExport bool plugin_is_enabled = false; \
     bool &varname = plugin_is_enabled;
 
+/// Call plugin_onupdate every interval frames (or ticks, see PluginUpdateFlags).
+/// Plugins with the same interval are spread over different frames.
+#define DFHACK_PLUGIN_UPDATE_CADENCE(varname, interval, flags) \
+    DFhackDataExport DFHack::PluginUpdateCadence plugin_update_cadence = { interval, flags }; \
+    DFHack::PluginUpdateCadence &varname = plugin_update_cadence;
+
 #define DFHACK_PLUGIN_LUA_COMMANDS \
     DFhackCExport const DFHack::CommandReg plugin_lua_commands[] =
 #define DFHACK_PLUGIN_LUA_FUNCTIONS \
@@ -27,6 +27,8 @@ distribution.
 #include "Export.h"
 #include "ColorText.h"
 
+#include <vector>
+
 class CPassiveSocket;
 class CActiveSocket;
 class CSimpleSocket;
@@ -57,9 +59,16 @@ namespace  DFHack
         RPC_REQUEST_QUIT = -4
     };
 
+    enum RPCCapabilityFlags {
+        // Replies may be deflated, see RPCMessageHeader::COMPRESSED
+        RPC_CAP_ZLIB = 0x100
+    };
+
     struct RPCHandshakeHeader {
         char magic[8];
-        int version;
+        int version; // protocol version in the low byte, RPCCapabilityFlags above
+
+        static const int VERSION_MASK = 0xFF;
 
         static const char REQUEST_MAGIC[9];
         static const char RESPONSE_MAGIC[9];
@@ -68,6 +77,11 @@ namespace  DFHack
     struct RPCMessageHeader {
         static const int MAX_MESSAGE_SIZE = 8*1048576;
 
+        // Set in size if the body is compressed
+        static const int32_t COMPRESSED = 0x40000000;
+        // Smaller messages are never compressed
+        static const int COMPRESS_THRESHOLD = 4096;
+
         int16_t id;
         int32_t size;
     };
@@ -80,6 +94,12 @@ namespace  DFHack
      *   request header. The server responds with the response
      *   magic. Currently both versions must be 1.
      *
+     *   The client may request optional features by setting
+     *   RPCCapabilityFlags bits above the low byte of the version,
+     *   and the server answers with the subset it accepted. Older
+     *   servers reject such requests, so clients only send them
+     *   when a feature was asked for.
+     *
      * 2. Interaction
      *
      *   Requests are done by exchanging messages between the
@@ -90,6 +110,13 @@ namespace  DFHack
      *   NOTE: As a special exception, RPC_REPLY_FAIL uses the size
      *         field to hold the error code directly.
      *
+     *   If RPC_CAP_ZLIB was accepted, server messages of at least
+     *   COMPRESS_THRESHOLD bytes are sent with the COMPRESSED bit
+     *   set in size. Their body is the int32 uncompressed size,
+     *   followed by data from a single zlib stream that lasts for
+     *   the whole connection, flushed with Z_SYNC_FLUSH after
+     *   every message.
+     *
      *   Every callable function is assigned a non-negative id by
      *   the server. Id 0 is reserved for BindMethod, which can be
      *   used to request any other id by function name. Id 1 is
@@ -109,6 +136,78 @@ namespace  DFHack
      *   closing the socket.
      */
 
+    /*
+     * Encoded elements of repeated message fields, appended to a
+     * message when it is sent. Since concatenated protobuf encodings
+     * merge, this lets large replies be produced one element at a
+     * time instead of as a complete object graph.
+     */
+    class DFHACK_EXPORT RPCReplyStream {
+    public:
+        typedef ::google::protobuf::MessageLite message_type;
+
+        static const int CHUNK_SIZE = 64*1024;
+
+        RPCReplyStream() : total_size(0) {}
+        ~RPCReplyStream() { clear(true); }
+
+        // Encode item as an element of the given repeated field
+        void add(int field, const message_type &item);
+
+        int size() const { return total_size; }
+        void clear(bool free = false);
+
+        int chunk_count() const { return int(chunks.size()); }
+        const uint8_t *chunk_data(int i) const { return chunks[i].data; }
+        int chunk_size(int i) const { return chunks[i].used; }
+
+    private:
+        struct Chunk {
+            uint8_t *data;
+            int used, size;
+        };
+
+        std::vector<Chunk> chunks;
+        int total_size;
+
+        uint8_t *reserve(int size);
+
+        RPCReplyStream(const RPCReplyStream&);
+        RPCReplyStream &operator= (const RPCReplyStream&);
+    };
+
+    /*
+     * A zlib stream that lives as long as the connection, so that
+     * consecutive messages share the compression dictionary.
+     */
+    class DFHACK_EXPORT RPCZStream {
+    public:
+        RPCZStream(bool deflate);
+        ~RPCZStream();
+
+        bool isValid() { return valid; }
+
+        // Compress data, appending to the output buffer; flush ends the message.
+        bool compress(const void *data, int size, bool flush);
+        // Decompress a whole message into exactly out_size bytes.
+        bool decompress(void *out, int out_size, const void *data, int size);
+
+        // Output buffer for compress, with room reserved for a header
+        void reset_output(int reserve);
+        uint8_t *output_data() { return output.empty() ? NULL : &output[0]; }
+        int output_size() const { return output_used; }
+
+    private:
+        void *stream;
+        bool deflating, valid;
+
+        std::vector<uint8_t> output;
+        int output_used;
+
+        RPCZStream(const RPCZStream&);
+        RPCZStream &operator= (const RPCZStream&);
+    };
+
     class DFHACK_EXPORT RemoteClient;
 
     class DFHACK_EXPORT RPCFunctionBase {
@@ -237,6 +336,10 @@ namespace  DFHack
 
         color_ostream &default_output() { return *p_default_output; };
 
+        // Ask the server to compress large replies; call before connect.
+        void set_compression(bool enable) { want_compression = enable; }
+        bool is_compressed() { return zstream != NULL; }
+
         bool connect(int port = -1);
         void disconnect();
 
@@ -256,6 +359,9 @@ namespace  DFHack
         CActiveSocket *socket;
         color_ostream *p_default_output;
 
+        bool want_compression;
+        RPCZStream *zstream;
+
         RemoteFunction<dfproto::CoreBindRequest,dfproto::CoreBindReply> bind_call;
         RemoteFunction<dfproto::CoreRunCommandRequest> runcmd_call;
 
@@ -49,6 +49,22 @@ namespace  DFHack
         SF_DONT_SUSPEND = 2
     };
 
+    /*
+     * Message sizes seen by a function on one connection. The input and
+     * output messages are kept between calls and only cleared, unless a
+     * call is much larger than usual; then they are freed instead.
+     */
+    struct RPCFunctionStats {
+        int calls;
+        int frees;
+        int avg_in_size, avg_out_size; // moving averages
+        int max_in_size, max_out_size;
+
+        RPCFunctionStats()
+            : calls(0), frees(0), avg_in_size(0), avg_out_size(0),
+              max_in_size(0), max_out_size(0) {}
+    };
+
     class DFHACK_EXPORT ServerFunctionBase : public RPCFunctionBase {
     public:
         const char *const name;
@@ -56,8 +72,16 @@ namespace  DFHack
 
         virtual command_result execute(color_ostream &stream) = 0;
 
+        // Elements appended to the reply by streamed functions
+        virtual RPCReplyStream *reply_stream() { return NULL; }
+
         int16_t getId() { return id; }
 
+        const RPCFunctionStats &getStats() { return stats; }
+
+        // Records the sizes of a finished call, and clears or frees the messages
+        void finish_call(int in_size, int out_size);
+
     protected:
         friend class RPCService;
 
@@ -69,6 +93,7 @@ namespace  DFHack
 
         RPCService *owner;
         int16_t id;
+        RPCFunctionStats stats;
     };
 
     template<typename In, typename Out>
@@ -89,6 +114,27 @@ namespace  DFHack
         function_type fptr;
     };
 
+    template<typename In, typename Out>
+    class StreamedServerFunction : public ServerFunctionBase {
+    public:
+        typedef command_result (*function_type)(color_ostream &out, const In *input, Out *output,
+                                                RPCReplyStream *reply);
+
+        In *in() { return static_cast<In*>(RPCFunctionBase::in()); }
+        Out *out() { return static_cast<Out*>(RPCFunctionBase::out()); }
+
+        StreamedServerFunction(RPCService *owner, const char *name, int flags, function_type fptr)
+            : ServerFunctionBase(&In::default_instance(), &Out::default_instance(), owner, name, flags),
+              fptr(fptr) {}
+
+        virtual command_result execute(color_ostream &stream) { return fptr(stream, in(), out(), &reply); }
+        virtual RPCReplyStream *reply_stream() { return &reply; }
+
+    private:
+        function_type fptr;
+        RPCReplyStream reply;
+    };
+
     template<typename In>
     class VoidServerFunction : public ServerFunctionBase {
     public:
@@ -173,6 +219,17 @@ namespace  DFHack
             functions.push_back(new ServerFunction<In,Out>(this, name, flags, fptr));
         }
 
+        template<typename In, typename Out>
+        void addFunction(
+            const char *name,
+            command_result (*fptr)(color_ostream &out, const In *input, Out *output,
+                                   RPCReplyStream *reply),
+            int flags = 0
+        ) {
+            assert(!owner);
+            functions.push_back(new StreamedServerFunction<In,Out>(this, name, flags, fptr));
+        }
+
         template<typename In>
         void addFunction(
             const char *name,
@@ -222,6 +279,14 @@ namespace  DFHack
         CActiveSocket *socket;
         connection_ostream stream;
 
+        // Reused for all requests; shrunk after unusually large ones
+        std::vector<uint8_t> in_buf;
+        int avg_in_size;
+        int in_buf_frees;
+
+        // Compresses replies, if the client asked for it
+        RPCZStream *zstream;
+
         std::vector<ServerFunctionBase*> functions;
 
         CoreService *core_service;
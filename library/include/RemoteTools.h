@@ -38,6 +38,11 @@ namespace df
     struct language_name;
 }
 
+namespace dfproto
+{
+    class GetWorldInfoOut;
+}
+
 namespace DFHack
 {
     struct MaterialInfo;
@@ -129,10 +134,17 @@ namespace DFHack
     DFHACK_EXPORT void describeUnit(BasicUnitInfo *info, df::unit *unit,
                                     const BasicUnitInfoMask *mask = NULL);
 
+    using dfproto::GetWorldInfoOut;
+
+    // The reply of GetWorldInfo; false if no world is loaded
+    DFHACK_EXPORT bool describeWorldInfo(GetWorldInfoOut *info);
+
     /////
 
     class CoreService : public RPCService {
         int suspend_depth;
+        // Snapshot parts requested for the bound functions
+        int snapshot_parts;
 
         static int doRunLuaFunction(lua_State *L);
     public:
@@ -152,5 +164,9 @@ namespace DFHack
         command_result RunLua(color_ostream &stream,
                               const dfproto::CoreRunLuaRequest *in,
                               StringListMessage *out);
+        // Same as RunLua, but in a pooled interpreter that only sees the snapshot
+        command_result RunLuaReadOnly(color_ostream &stream,
+                                      const dfproto::CoreRunLuaRequest *in,
+                                      StringListMessage *out);
     };
 }
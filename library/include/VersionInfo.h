@@ -48,6 +48,8 @@ namespace DFHack
     struct DFHACK_EXPORT VersionInfo
     {
     private:
+        friend class VersionInfoFactory; // reads and writes the symbol cache
+
         std::vector <std::string> md5_list;
         std::vector <uint32_t> PE_list;
         std::map <std::string, uint32_t> Addresses;
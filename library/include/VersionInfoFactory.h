@@ -28,6 +28,10 @@ distribution.
 #include "Pragma.h"
 #include "Export.h"
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+
 class TiXmlElement;
 namespace DFHack
 {
@@ -46,6 +50,13 @@ namespace DFHack
             void clear();
         private:
             void ParseVersion (TiXmlElement* version, VersionInfo* mem);
+            bool loadXML(std::string path_to_xml);
+            // binary copy of the parsed tables, next to the xml
+            bool loadCache(std::string path_to_cache, const std::vector<char> &key);
+            void saveCache(std::string path_to_cache, const std::vector<char> &key);
+            void buildIndex();
             bool error;
+            std::unordered_map<std::string, VersionInfo*> md5_index;
+            std::unordered_map<uint32_t, VersionInfo*> pe_index;
     };
 }
@@ -103,6 +103,12 @@ DFHACK_EXPORT df::building *findAtTile(df::coord pos);
  */
 DFHACK_EXPORT bool findCivzonesAt(std::vector<df::building_civzonest*> *pvec, df::coord pos);
 
+/**
+ * Find buildings and civzones with bounding rectangles that intersect
+ * the box between the two corners, inclusive.
+ */
+DFHACK_EXPORT bool findInBox(std::vector<df::building*> *pvec, df::coord p1, df::coord p2);
+
 /**
  * Allocates a building object using this type and position.
  */
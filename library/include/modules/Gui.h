@@ -58,6 +58,8 @@ namespace DFHack
     namespace Gui
     {
         DFHACK_EXPORT std::string getFocusString(df::viewscreen *top);
+        // Drop cached focus strings; call after changing UI state directly
+        DFHACK_EXPORT void InvalidateFocusCache();
 
         // Full-screen item details view
         DFHACK_EXPORT bool item_details_hotkey(df::viewscreen *top);
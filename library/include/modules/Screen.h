@@ -31,6 +31,7 @@ distribution.
 
 #include <string>
 #include <set>
+#include <vector>
 
 #include "DataDefs.h"
 #include "df/graphic.h"
@@ -179,6 +180,11 @@ namespace DFHack
         /// Fills a rectangle with one pen. Possibly more efficient than a loop over paintTile.
         DFHACK_EXPORT bool fillRect(const Pen &pen, int x1, int y1, int x2, int y2);
 
+        /// Paints a width x height block of pens, stored row by row, with the top left corner at x,y.
+        /// The block is clipped once and written plane by plane; tiles with invalid pens are skipped.
+        /// Rows are stride pens apart; 0 means the rows are packed.
+        DFHACK_EXPORT bool blit(const Pen *pens, int x, int y, int width, int height, int stride = 0);
+
         /// Draws a standard dark gray window border with a title string
         DFHACK_EXPORT bool drawBorder(const std::string &title);
 
@@ -274,8 +280,22 @@ namespace DFHack
     class DFHACK_EXPORT dfhack_viewscreen : public df::viewscreen {
         df::coord2d last_size;
 
+        // Dirty region tracking: the bounding box of the areas that
+        // changed since the last render, and a copy of the screen
+        // as it was left by that render.
+        bool has_dirty;
+        rect2d dirty_area;
+        std::vector<Screen::Pen> back_buffer;
+
     protected:
         bool text_input_mode;
+        bool track_dirty;
+
+        /// If anything is dirty, returns true and the area that must be painted.
+        bool beginRender(rect2d *area);
+        /// Call after painting the area returned by beginRender, or with NULL if it returned
+        /// false. Restores everything else from the back buffer and saves the new contents.
+        void endRender(const rect2d *area);
 
     public:
         dfhack_viewscreen();
@@ -302,6 +322,12 @@ namespace DFHack
 
         virtual bool is_lua_screen() { return false; }
 
+        /// Marks the whole screen or an area of it for repainting on the next render
+        void markDirty();
+        void markDirty(const rect2d &area);
+        bool isDirty() const { return has_dirty; }
+        bool isTrackingDirty() const { return track_dirty; }
+
         virtual std::string getFocusString() = 0;
         virtual void onShow() {};
         virtual void onDismiss() {};
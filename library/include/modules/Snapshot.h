@@ -0,0 +1,141 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+
+#pragma once
+#ifndef CL_MOD_SNAPSHOT
+#define CL_MOD_SNAPSHOT
+/**
+ * \defgroup grp_snapshot Snapshot: per-tick copies of hot world data for other threads
+ * @ingroup grp_modules
+ */
+
+#include "Export.h"
+#include "DataDefs.h"
+#include "df/coord.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dfproto
+{
+    class BasicUnitInfo;
+    class GetWorldInfoOut;
+}
+
+namespace DFHack
+{
+namespace Snapshot
+{
+    /**
+     * Parts of the world a snapshot can contain.
+     * \ingroup grp_snapshot
+     */
+    enum Contents
+    {
+        UNITS = 1,
+        JOBS = 2,
+        ITEMS = 4,
+        ANNOUNCEMENTS = 8,
+        // replies of the ListUnits and GetWorldInfo RPC calls
+        UNIT_DETAILS = 16,
+        WORLD_INFO = 32
+    };
+
+    struct UnitInfo
+    {
+        int32_t id;
+        df::coord pos;
+        int32_t race;
+        int32_t civ_id;
+        int16_t profession;
+        uint32_t flags1;
+        uint32_t flags2;
+    };
+
+    /**
+     * A unit as ListUnits describes it, with every optional part filled
+     * in, plus the fields its filters test.
+     */
+    struct UnitDetails
+    {
+        int32_t id;
+        int32_t race;
+        int32_t civ_id;
+        bool dead, alive, sane;
+        std::shared_ptr<dfproto::BasicUnitInfo> info;
+    };
+
+    struct AnnouncementInfo
+    {
+        std::string text;
+        int16_t color;
+        bool bright;
+        bool continuation;
+    };
+
+    /**
+     * An immutable copy of the world taken at the end of a game tick.
+     * \ingroup grp_snapshot
+     */
+    struct WorldSnapshot
+    {
+        int contents;       // Contents flags that were filled in
+        uint32_t serial;    // increases with every published snapshot
+        uint32_t year;
+        uint32_t year_tick;
+
+        std::vector<UnitInfo> units;                    // world->units.active
+        int32_t job_count;
+        std::vector<int32_t> jobs_by_type;              // indexed by df::job_type
+        std::vector<int32_t> items_by_type;             // indexed by df::item_type
+        std::vector<AnnouncementInfo> announcements;    // the most recent reports
+        std::vector<UnitDetails> unit_details;          // world->units.all, sorted by id
+        std::shared_ptr<dfproto::GetWorldInfoOut> world_info;   // empty if no world is loaded
+    };
+
+    typedef std::shared_ptr<const WorldSnapshot> Ptr;
+
+    /// Ask for the given Contents to be captured; requests are counted per flag.
+    DFHACK_EXPORT void Request(int contents);
+    /// Undo an earlier Request.
+    DFHACK_EXPORT void Release(int contents);
+    /// Take a new copy at the next update even if the game is paused,
+    /// e.g. after changing captured data from an RPC call.
+    DFHACK_EXPORT void Invalidate();
+
+    /**
+     * Returns the latest snapshot, or an empty pointer if nothing was requested.
+     * Safe to call from any thread without suspending the core; the returned
+     * data stays valid for as long as the pointer is held.
+     */
+    DFHACK_EXPORT Ptr Get();
+
+    // Called by the core at the end of each update, and when the world changes.
+    DFHACK_EXPORT void Publish();
+    DFHACK_EXPORT void Clear();
+}
+}
+#endif
@@ -55,8 +55,12 @@ DFHACK_EXPORT void setNickname(df::language_name *name, std::string nick);
 DFHACK_EXPORT std::string capitalize(const std::string &str, bool all_words = false);
 
 // translate a name using the loaded dictionaries
+// results are cached per name object and recomputed when its contents change
 DFHACK_EXPORT std::string TranslateName (const df::language_name * name, bool inEnglish = true,
                                          bool onlyLastPart = false);
+
+// drop all cached translations; called by the core when the world changes
+DFHACK_EXPORT void ClearCache();
 }
 }
 #endif
@@ -177,8 +177,12 @@ namespace DFHack
 
         DFHACK_EXPORT void ClearPersistentCache();
 
+        // Per-block tile masks owned by a persistent entry. They are kept in
+        // a companion entry and deleted together with the owner.
         DFHACK_EXPORT df::tile_bitmask *getPersistentTilemask(const PersistentDataItem &item, df::map_block *block, bool create = false);
         DFHACK_EXPORT bool deletePersistentTilemask(const PersistentDataItem &item, df::map_block *block);
+        // Writes modified tile masks back into their entries; called every frame by the core.
+        DFHACK_EXPORT void SyncPersistentTilemasks();
     }
 }
 #endif
@@ -488,6 +488,7 @@ end
 Screen = defclass(Screen, View)
 
 Screen.text_input_mode = false
+Screen.track_dirty = false
 
 function Screen:postinit()
     self:onResize(dscreen.getWindowSize())
@@ -507,6 +508,16 @@ function Screen:invalidate()
     dscreen.invalidate()
 end
 
+function Screen:markDirty(rect)
+    if not self._native then
+        return
+    elseif rect then
+        dscreen.markDirty(self, rect.x1, rect.y1, rect.x2, rect.y2)
+    else
+        dscreen.markDirty(self)
+    end
+end
+
 function Screen:renderParent()
     if self._native and self._native.parent then
         self._native.parent:render()
@@ -555,8 +566,8 @@ function Screen:onResize(w,h)
     self:updateLayout(ViewRect{ rect = mkdims_wh(0,0,w,h) })
 end
 
-function Screen:onRender()
-    self:render(Painter.new())
+function Screen:onRender(dirty_rect)
+    self:render(Painter{ clip_rect = dirty_rect })
 end
 
 ------------------------
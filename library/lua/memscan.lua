@@ -83,20 +83,47 @@ function CheckedArray:find(data,sidx,eidx,reverse)
         )
     end
 end
+function CheckedArray:find_all(data,sidx,eidx,limit)
+    local dcnt = #data
+    sidx = math.max(0, sidx or 0)
+    eidx = math.min(self.count, eidx or self.count)
+    if (eidx - sidx) >= dcnt and dcnt > 0 then
+        return dfhack.with_temp_object(
+            df.new(self.type, dcnt),
+            function(buffer)
+                for i = 1,dcnt do
+                    buffer[i-1] = data[i]
+                end
+                local cnt = eidx - sidx - dcnt
+                local step = self.esize
+                local sptr = self.start + sidx*step
+                local list = dfhack.internal.memscanAll(sptr, cnt, step, buffer, dcnt*step, limit)
+                if list then
+                    for i = 1,#list do
+                        list[i] = sidx + list[i]
+                    end
+                end
+                return list
+            end
+        )
+    end
+end
 function CheckedArray:find_one(data,sidx,eidx,reverse)
-    local idx, addr = self:find(data,sidx,eidx,reverse)
-    if idx then
-        -- Verify this is the only match
-        if reverse then
-            eidx = idx+#data-1
-        else
-            sidx = idx+1
-        end
-        if self:find(data,sidx,eidx,reverse) then
-            return nil
+    if reverse then
+        local idx, addr = self:find(data,sidx,eidx,reverse)
+        if idx then
+            -- Verify this is the only match
+            if self:find(data,sidx,idx+#data-1,reverse) then
+                return nil
+            end
         end
+        return idx, addr
+    end
+    -- One scan for up to two matches
+    local list = self:find_all(data,sidx,eidx,2)
+    if list and #list == 1 then
+        return list[1], self:idx2addr(list[1])
     end
-    return idx, addr
 end
 function CheckedArray:list_changes(old_arr,old_val,new_val,delta)
     if old_arr.type ~= self.type or old_arr.count ~= self.count then
@@ -106,18 +133,7 @@ function CheckedArray:list_changes(old_arr,old_val,new_val,delta)
     local optr = old_arr.start
     local nptr = self.start
     local esize = self.esize
-    local rv
-    local sidx = 0
-    while true do
-        local idx = dfhack.internal.diffscan(optr, nptr, sidx, eidx, esize, old_val, new_val, delta)
-        if not idx then
-            break
-        end
-        rv = rv or {}
-        rv[#rv+1] = idx
-        sidx = idx+1
-    end
-    return rv
+    return dfhack.internal.diffscanAll(optr, nptr, 0, eidx, esize, old_val, new_val, delta)
 end
 function CheckedArray:filter_changes(prev_list,old_arr,old_val,new_val,delta)
     if old_arr.type ~= self.type or old_arr.count ~= self.count then
@@ -29,6 +29,7 @@ distribution.
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -81,7 +82,122 @@ struct CoordHash {
     }
 };
 
-static unordered_map<df::coord, int32_t, CoordHash> locationToBuilding;
+/*
+ * Spatial index of buildings and civzones. Every z-level is split into
+ * block-sized buckets, each listing the ids of the buildings whose bounding
+ * rectangle overlaps it. New buildings are picked up by comparing
+ * building_next_id with the last indexed id; updateBuildings re-indexes
+ * changed ones and drops destroyed ones, and ids that no longer resolve
+ * are skipped on lookup.
+ */
+struct BuildingBounds {
+    df::coord p1, p2;
+};
+
+static unordered_map<df::coord, vector<int32_t>, CoordHash> buildingBuckets;
+static unordered_map<int32_t, BuildingBounds> buildingBounds;
+// ids that were allocated, but not yet added to the building vector
+static vector<int32_t> pendingBuildings;
+static int32_t indexNextId = -1;
+
+static const size_t max_pending_buildings = 64;
+
+static void unindexBuilding(int32_t id);
+
+static void indexBuilding(df::building *bld)
+{
+    // the extent may have changed since the building was indexed
+    if (buildingBounds.count(bld->id))
+        unindexBuilding(bld->id);
+
+    BuildingBounds bounds;
+    bounds.p1 = df::coord(min(bld->x1, bld->x2), min(bld->y1, bld->y2), bld->z);
+    bounds.p2 = df::coord(max(bld->x1, bld->x2), max(bld->y1, bld->y2), bld->z);
+    buildingBounds[bld->id] = bounds;
+
+    for (int bx = bounds.p1.x >> 4; bx <= (bounds.p2.x >> 4); bx++)
+        for (int by = bounds.p1.y >> 4; by <= (bounds.p2.y >> 4); by++)
+            buildingBuckets[df::coord(bx, by, bld->z)].push_back(bld->id);
+}
+
+static void unindexBuilding(int32_t id)
+{
+    auto it = buildingBounds.find(id);
+    if (it == buildingBounds.end())
+        return;
+
+    auto &bounds = it->second;
+
+    for (int bx = bounds.p1.x >> 4; bx <= (bounds.p2.x >> 4); bx++)
+    {
+        for (int by = bounds.p1.y >> 4; by <= (bounds.p2.y >> 4); by++)
+        {
+            auto bucket = buildingBuckets.find(df::coord(bx, by, bounds.p1.z));
+            if (bucket == buildingBuckets.end())
+                continue;
+
+            auto &ids = bucket->second;
+            ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+            if (ids.empty())
+                buildingBuckets.erase(bucket);
+        }
+    }
+
+    buildingBounds.erase(it);
+}
+
+static bool syncBuildingIndex()
+{
+    if (!building_next_id || !world || !Maps::IsValid())
+        return false;
+
+    if (indexNextId < 0)
+    {
+        buildingBuckets.clear();
+        buildingBounds.clear();
+        pendingBuildings.clear();
+
+        auto &vec = df::building::get_vector();
+        for (size_t i = 0; i < vec.size(); i++)
+            indexBuilding(vec[i]);
+        indexNextId = *building_next_id;
+        return true;
+    }
+
+    for (size_t i = 0; i < pendingBuildings.size(); )
+    {
+        if (auto bld = df::building::find(pendingBuildings[i]))
+        {
+            indexBuilding(bld);
+            pendingBuildings.erase(pendingBuildings.begin() + i);
+        }
+        else
+            i++;
+    }
+
+    for (; indexNextId < *building_next_id; indexNextId++)
+    {
+        if (auto bld = df::building::find(indexNextId))
+            indexBuilding(bld);
+        else
+            pendingBuildings.push_back(indexNextId);
+    }
+
+    // Rather than forget some of the pending ids, start over from the vector
+    if (pendingBuildings.size() > max_pending_buildings)
+    {
+        indexNextId = -1;
+        return syncBuildingIndex();
+    }
+
+    return true;
+}
+
+static const vector<int32_t> *getBuildingBucket(df::coord pos)
+{
+    auto it = buildingBuckets.find(df::coord(pos.x >> 4, pos.y >> 4, pos.z));
+    return (it != buildingBuckets.end()) ? &it->second : NULL;
+}
 
 static uint8_t *getExtentTile(df::building_extents &extent, df::coord2d tile)
 {
@@ -205,23 +321,43 @@ bool Buildings::setOwner(df::building *bld, df::unit *unit)
     return true;
 }
 
+static bool isBuildingAtTile(df::building *bld, df::coord pos)
+{
+    if (pos.z != bld->z ||
+        pos.x < bld->x1 || pos.x > bld->x2 ||
+        pos.y < bld->y1 || pos.y > bld->y2)
+        return false;
+
+    if (!bld->isSettingOccupancy())
+        return false;
+
+    if (bld->room.extents && bld->isExtentShaped())
+    {
+        auto etile = getExtentTile(bld->room, pos);
+        if (!etile || !*etile)
+            return false;
+    }
+
+    return true;
+}
+
 df::building *Buildings::findAtTile(df::coord pos)
 {
     auto occ = Maps::getTileOccupancy(pos);
     if (!occ || !occ->bits.building)
         return NULL;
 
-    // Try cache lookup in case it works:
-    auto cached = locationToBuilding.find(pos);
-    if (cached != locationToBuilding.end())
+    // Try the index lookup in case it works:
+    if (syncBuildingIndex())
     {
-        auto building = df::building::find(cached->second);
-
-        if (building && building->z == pos.z &&
-            building->isSettingOccupancy() &&
-            containsTile(building, pos, false))
+        if (auto ids = getBuildingBucket(pos))
         {
-            return building;
+            for (size_t i = 0; i < ids->size(); i++)
+            {
+                auto bld = df::building::find((*ids)[i]);
+                if (bld && isBuildingAtTile(bld, pos))
+                    return bld;
+            }
         }
     }
 
@@ -231,22 +367,8 @@ df::building *Buildings::findAtTile(df::coord pos)
     {
         auto bld = vec[i];
 
-        if (pos.z != bld->z ||
-            pos.x < bld->x1 || pos.x > bld->x2 ||
-            pos.y < bld->y1 || pos.y > bld->y2)
-            continue;
-
-        if (!bld->isSettingOccupancy())
-            continue;
-
-        if (bld->room.extents && bld->isExtentShaped())
-        {
-            auto etile = getExtentTile(bld->room, pos);
-            if (!etile || !*etile)
-                continue;
-        }
-
-        return bld;
+        if (isBuildingAtTile(bld, pos))
+            return bld;
     }
 
     return NULL;
@@ -256,6 +378,24 @@ bool Buildings::findCivzonesAt(std::vector<df::building_civzonest*> *pvec, df::c
 {
     pvec->clear();
 
+    if (syncBuildingIndex())
+    {
+        if (auto ids = getBuildingBucket(pos))
+        {
+            for (size_t i = 0; i < ids->size(); i++)
+            {
+                auto bld = strict_virtual_cast<df::building_civzonest>(df::building::find((*ids)[i]));
+
+                if (!bld || bld->z != pos.z || !containsTile(bld, pos))
+                    continue;
+
+                pvec->push_back(bld);
+            }
+        }
+
+        return !pvec->empty();
+    }
+
     auto &vec = world->buildings.other[buildings_other_id::CIVZONE];
 
     for (size_t i = 0; i < vec.size(); i++)
@@ -271,6 +411,59 @@ bool Buildings::findCivzonesAt(std::vector<df::building_civzonest*> *pvec, df::c
     return !pvec->empty();
 }
 
+static bool overlapsBox(df::building *bld, const df::coord &lo, const df::coord &hi)
+{
+    return bld->z >= lo.z && bld->z <= hi.z &&
+           max(bld->x1, bld->x2) >= lo.x && min(bld->x1, bld->x2) <= hi.x &&
+           max(bld->y1, bld->y2) >= lo.y && min(bld->y1, bld->y2) <= hi.y;
+}
+
+bool Buildings::findInBox(std::vector<df::building*> *pvec, df::coord p1, df::coord p2)
+{
+    pvec->clear();
+
+    df::coord lo(min(p1.x, p2.x), min(p1.y, p2.y), min(p1.z, p2.z));
+    df::coord hi(max(p1.x, p2.x), max(p1.y, p2.y), max(p1.z, p2.z));
+
+    if (!syncBuildingIndex())
+    {
+        auto &vec = df::building::get_vector();
+        for (size_t i = 0; i < vec.size(); i++)
+            if (overlapsBox(vec[i], lo, hi))
+                pvec->push_back(vec[i]);
+
+        return !pvec->empty();
+    }
+
+    std::set<int32_t> seen;
+
+    for (int z = lo.z; z <= hi.z; z++)
+    {
+        for (int bx = lo.x >> 4; bx <= (hi.x >> 4); bx++)
+        {
+            for (int by = lo.y >> 4; by <= (hi.y >> 4); by++)
+            {
+                auto bucket = buildingBuckets.find(df::coord(bx, by, z));
+                if (bucket == buildingBuckets.end())
+                    continue;
+
+                auto &ids = bucket->second;
+                for (size_t i = 0; i < ids.size(); i++)
+                {
+                    if (!seen.insert(ids[i]).second)
+                        continue;
+
+                    auto bld = df::building::find(ids[i]);
+                    if (bld && overlapsBox(bld, lo, hi))
+                        pvec->push_back(bld);
+                }
+            }
+        }
+    }
+
+    return !pvec->empty();
+}
+
 df::building *Buildings::allocInstance(df::coord pos, df::building_type type, int subtype)
 {
     if (!building_next_id)
@@ -905,13 +1098,11 @@ bool Buildings::deconstruct(df::building *bld)
     return true;
 }
 
-static unordered_map<int32_t, df::coord> corner1;
-static unordered_map<int32_t, df::coord> corner2;
-
 void Buildings::clearBuildings(color_ostream& out) {
-    corner1.clear();
-    corner2.clear();
-    locationToBuilding.clear();
+    buildingBuckets.clear();
+    buildingBounds.clear();
+    pendingBuildings.clear();
+    indexNextId = -1;
 }
 
 void Buildings::updateBuildings(color_ostream& out, void* ptr)
@@ -920,46 +1111,7 @@ void Buildings::updateBuildings(color_ostream& out, void* ptr)
     auto building = df::building::find(id);
 
     if (building)
-    {
-        // Already cached -> weird, so bail out
-        if (corner1.count(id))
-            return;
-        // Civzones cannot be cached because they can
-        // overlap each other and normal buildings.
-        if (!building->isSettingOccupancy())
-            return;
-
-        df::coord p1(min(building->x1, building->x2), min(building->y1,building->y2), building->z);
-        df::coord p2(max(building->x1, building->x2), max(building->y1,building->y2), building->z);
-
-        corner1[id] = p1;
-        corner2[id] = p2;
-
-        for ( int32_t x = p1.x; x <= p2.x; x++ ) {
-            for ( int32_t y = p1.y; y <= p2.y; y++ ) {
-                df::coord pt(x,y,building->z);
-                if (containsTile(building, pt, false))
-                    locationToBuilding[pt] = id;
-            }
-        }
-    }
-    else if (corner1.count(id))
-    {
-        //existing building: destroy it
-        df::coord p1 = corner1[id];
-        df::coord p2 = corner2[id];
-
-        for ( int32_t x = p1.x; x <= p2.x; x++ ) {
-            for ( int32_t y = p1.y; y <= p2.y; y++ ) {
-                df::coord pt(x,y,p1.z);
-
-                auto cur = locationToBuilding.find(pt);
-                if (cur != locationToBuilding.end() && cur->second == id)
-                    locationToBuilding.erase(cur);
-            }
-        }
-
-        corner1.erase(id);
-        corner2.erase(id);
-    }
+        indexBuilding(building);
+    else
+        unindexBuilding(id);
 }
@@ -187,7 +187,7 @@ void DFHack::EventManager::onStateChange(color_ostream& out, state_change_event
         
         for ( size_t a = 0; a < df::global::world->buildings.all.size(); a++ ) {
             df::building* b = df::global::world->buildings.all[a];
-            Buildings::updateBuildings(out, (void*)b);
+            Buildings::updateBuildings(out, (void*)b->id);
             buildings.insert(b->id);
         }
         for ( size_t a = 0; a < EventType::EVENT_MAX; a++ ) {
@@ -363,14 +363,29 @@ DEFINE_GET_FOCUS_STRING_HANDLER(layer_stockpile)
     }
 }
 
-std::string Gui::getFocusString(df::viewscreen *top)
+/*
+ * The handlers only look at state that DF changes while processing
+ * input, so the result is cached per screen until the next frame,
+ * a viewscreen change or simulated input.
+ */
+
+static std::map<df::viewscreen*, std::string> focusStringCache;
+static std::map<virtual_identity*, std::string> focusNameChunks;
+
+void Gui::InvalidateFocusCache()
 {
-    if (!top)
-        return "";
+    focusStringCache.clear();
+}
 
+static std::string computeFocusString(df::viewscreen *top)
+{
     if (virtual_identity *id = virtual_identity::get(top))
     {
-        std::string name = getNameChunk(id, 11, 2);
+        auto it = focusNameChunks.find(id);
+        if (it == focusNameChunks.end())
+            it = focusNameChunks.insert(std::make_pair(id, getNameChunk(id, 11, 2))).first;
+
+        std::string name = it->second;
 
         auto handler = map_find(getFocusStringHandlers, id);
         if (handler)
@@ -391,6 +406,18 @@ std::string Gui::getFocusString(df::viewscreen *top)
     }
 }
 
+std::string Gui::getFocusString(df::viewscreen *top)
+{
+    if (!top)
+        return "";
+
+    auto it = focusStringCache.find(top);
+    if (it == focusStringCache.end())
+        it = focusStringCache.insert(std::make_pair(top, computeFocusString(top))).first;
+
+    return it->second;
+}
+
 // Predefined common guard functions
 
 bool Gui::default_hotkey(df::viewscreen *top)
@@ -32,6 +32,7 @@ distribution.
 using namespace std;
 
 #include "modules/Screen.h"
+#include "modules/Gui.h"
 #include "MemAccess.h"
 #include "VersionInfo.h"
 #include "Types.h"
@@ -88,6 +89,7 @@ void Screen::setKeyPressed(df::interface_key key)
 {
     gview->current_key = gview->keybinds[key].key;
     gview->current_shift = gview->keybinds[key].is_shift;
+    Gui::InvalidateFocusCache();
 }
 
 void Screen::getKeys(std::set<df::interface_key> &keys)
@@ -173,20 +175,53 @@ bool Screen::paintString(const Pen &pen, int x, int y, const std::string &text)
     Pen tmp(pen);
     bool ok = false;
 
-    for (size_t i = -std::min(0,x); i < text.size(); i++)
-    {
-        if (x + i >= size_t(dim.x))
-            break;
+    size_t end = std::min(text.size(), size_t(std::max(0, dim.x - x)));
 
+    for (size_t i = -std::min(0,x); i < end; i++)
+    {
         tmp.ch = text[i];
         tmp.tile = (pen.tile ? pen.tile + uint8_t(text[i]) : 0);
-        paintTile(tmp, x+i, y);
-        ok = true;
+        if (tmp.valid())
+        {
+            doSetTile(tmp, x+i, y);
+            ok = true;
+        }
     }
 
     return ok;
 }
 
+/*
+ * The screen planes are indexed [x][y], so the bulk functions below
+ * clip their rectangle once and then sweep each plane down a column,
+ * which keeps the writes contiguous.
+ */
+
+static void doFillColumn(const Pen &pen, int x, int y1, int y2)
+{
+    for (int y = y1; y <= y2; y++)
+    {
+        gps->screen[x][y].chr = uint8_t(pen.ch);
+        gps->screen[x][y].fore = uint8_t(pen.fg) & 15;
+        gps->screen[x][y].back = uint8_t(pen.bg) & 15;
+        gps->screen[x][y].bright = uint8_t(pen.bold) & 1;
+    }
+
+    uint8_t addcolor = (pen.tile_mode == Screen::Pen::CharColor);
+    uint8_t grayscale = (pen.tile_mode == Screen::Pen::TileColor);
+
+    for (int y = y1; y <= y2; y++)
+        gps->screentexpos[x][y] = pen.tile;
+    for (int y = y1; y <= y2; y++)
+        gps->screentexpos_addcolor[x][y] = addcolor;
+    for (int y = y1; y <= y2; y++)
+        gps->screentexpos_grayscale[x][y] = grayscale;
+    for (int y = y1; y <= y2; y++)
+        gps->screentexpos_cf[x][y] = pen.tile_fg;
+    for (int y = y1; y <= y2; y++)
+        gps->screentexpos_cbr[x][y] = pen.tile_bg;
+}
+
 bool Screen::fillRect(const Pen &pen, int x1, int y1, int x2, int y2)
 {
     auto dim = getWindowSize();
@@ -199,12 +234,53 @@ bool Screen::fillRect(const Pen &pen, int x1, int y1, int x2, int y2)
     if (x1 > x2 || y1 > y2) return false;
 
     for (int x = x1; x <= x2; x++)
+        doFillColumn(pen, x, y1, y2);
+
+    return true;
+}
+
+bool Screen::blit(const Pen *pens, int x, int y, int width, int height, int stride)
+{
+    CHECK_NULL_POINTER(pens);
+
+    auto dim = getWindowSize();
+    if (!gps || width <= 0 || height <= 0) return false;
+    if (stride <= 0) stride = width;
+
+    int x1 = std::max(0, x), x2 = std::min(dim.x, x + width) - 1;
+    int y1 = std::max(0, y), y2 = std::min(dim.y, y + height) - 1;
+    if (x1 > x2 || y1 > y2) return false;
+
+    bool ok = false;
+
+    for (int sx = x1; sx <= x2; sx++)
     {
-        for (int y = y1; y <= y2; y++)
-            doSetTile(pen, x, y);
+        const Pen *col = pens + (sx - x);
+        int y0 = y;
+
+#define FOR_PENS(stmt) \
+        for (int sy = y1; sy <= y2; sy++) { \
+            const Pen &pen = col[(sy - y0)*stride]; \
+            if (pen.valid()) { stmt; } \
+        }
+
+        FOR_PENS(
+            gps->screen[sx][sy].chr = uint8_t(pen.ch);
+            gps->screen[sx][sy].fore = uint8_t(pen.fg) & 15;
+            gps->screen[sx][sy].back = uint8_t(pen.bg) & 15;
+            gps->screen[sx][sy].bright = uint8_t(pen.bold) & 1;
+            ok = true
+        )
+        FOR_PENS(gps->screentexpos[sx][sy] = pen.tile)
+        FOR_PENS(gps->screentexpos_addcolor[sx][sy] = (pen.tile_mode == Screen::Pen::CharColor))
+        FOR_PENS(gps->screentexpos_grayscale[sx][sy] = (pen.tile_mode == Screen::Pen::TileColor))
+        FOR_PENS(gps->screentexpos_cf[sx][sy] = pen.tile_fg)
+        FOR_PENS(gps->screentexpos_cbr[sx][sy] = pen.tile_bg)
+
+#undef FOR_PENS
     }
 
-    return true;
+    return ok;
 }
 
 bool Screen::drawBorder(const std::string &title)
@@ -307,6 +383,8 @@ bool Screen::show(df::viewscreen *screen, df::viewscreen *before)
     if (dfhack_viewscreen::is_instance(screen))
         static_cast<dfhack_viewscreen*>(screen)->onShow();
 
+    // The new screen may reuse the address of a deleted one
+    Gui::InvalidateFocusCache();
     return true;
 }
 
@@ -349,11 +427,12 @@ string Screen::getKeyDisplay(df::interface_key key)
 
 static std::set<df::viewscreen*> dfhack_screens;
 
-dfhack_viewscreen::dfhack_viewscreen() : text_input_mode(false)
+dfhack_viewscreen::dfhack_viewscreen() : has_dirty(false), text_input_mode(false), track_dirty(false)
 {
     dfhack_screens.insert(this);
 
     last_size = Screen::getWindowSize();
+    markDirty();
 }
 
 dfhack_viewscreen::~dfhack_viewscreen()
@@ -375,9 +454,83 @@ void dfhack_viewscreen::input()
 {
     std::set<df::interface_key> keys;
     Screen::getKeys(keys);
+    if (!keys.empty())
+        markDirty();
     feed(&keys);
 }
 
+void dfhack_viewscreen::markDirty()
+{
+    markDirty(Screen::getScreenRect());
+}
+
+void dfhack_viewscreen::markDirty(const rect2d &area)
+{
+    if (area.first.x > area.second.x || area.first.y > area.second.y)
+        return;
+
+    if (!has_dirty)
+    {
+        dirty_area = area;
+        has_dirty = true;
+        return;
+    }
+
+    dirty_area.first.x = std::min(dirty_area.first.x, area.first.x);
+    dirty_area.first.y = std::min(dirty_area.first.y, area.first.y);
+    dirty_area.second.x = std::max(dirty_area.second.x, area.second.x);
+    dirty_area.second.y = std::max(dirty_area.second.y, area.second.y);
+}
+
+bool dfhack_viewscreen::beginRender(rect2d *area)
+{
+    auto dim = Screen::getWindowSize();
+    if (dim != last_size || back_buffer.size() != size_t(dim.x*dim.y))
+    {
+        last_size = dim;
+        back_buffer.assign(dim.x*dim.y, Pen(0,0,0,-1));
+        markDirty();
+    }
+
+    if (!has_dirty)
+        return false;
+
+    *area = intersect(dirty_area, Screen::getScreenRect());
+    return true;
+}
+
+void dfhack_viewscreen::endRender(const rect2d *area)
+{
+    int w = last_size.x, h = last_size.y;
+    if (back_buffer.empty())
+        return;
+
+    if (!area)
+    {
+        Screen::blit(&back_buffer[0], 0, 0, w, h);
+        return;
+    }
+
+    int x1 = area->first.x, y1 = area->first.y;
+    int x2 = area->second.x, y2 = area->second.y;
+
+    if (x1 <= x2 && y1 <= y2)
+    {
+        // Restore the bands around the painted area
+        Screen::blit(&back_buffer[0], 0, 0, w, y1);
+        Screen::blit(&back_buffer[(y2+1)*w], 0, y2+1, w, h-y2-1);
+        Screen::blit(&back_buffer[y1*w], 0, y1, x1, y2-y1+1, w);
+        Screen::blit(&back_buffer[y1*w+x2+1], x2+1, y1, w-x2-1, y2-y1+1, w);
+
+        // Save the freshly painted contents
+        for (int y = y1; y <= y2; y++)
+            for (int x = x1; x <= x2; x++)
+                back_buffer[y*w+x] = Screen::readTile(x, y);
+    }
+
+    has_dirty = false;
+}
+
 void dfhack_viewscreen::logic()
 {
     // Various stuff works poorly unless always repainting
@@ -497,6 +650,10 @@ void dfhack_lua_viewscreen::update_focus(lua_State *L, int idx)
     text_input_mode = lua_toboolean(L, -1);
     lua_pop(L, 1);
 
+    lua_getfield(L, idx, "track_dirty");
+    track_dirty = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
     lua_getfield(L, idx, "focus_path");
     auto str = lua_tostring(L, -1);
     if (!str) str = "";
@@ -511,6 +668,8 @@ void dfhack_lua_viewscreen::update_focus(lua_State *L, int idx)
 
 int dfhack_lua_viewscreen::do_render(lua_State *L)
 {
+    int args = lua_gettop(L);
+
     auto self = get_self(L);
     if (!self) return 0;
 
@@ -523,7 +682,23 @@ int dfhack_lua_viewscreen::do_render(lua_State *L)
     }
 
     lua_pushvalue(L, -2);
-    lua_call(L, 1, 0);
+
+    // pass the dirty area as a rect table
+    if (args >= 5)
+    {
+        static const char *const fields[] = { "x1", "y1", "x2", "y2" };
+
+        lua_createtable(L, 0, 4);
+        for (int i = 0; i < 4; i++)
+        {
+            lua_pushvalue(L, i+2);
+            lua_setfield(L, -2, fields[i]);
+        }
+        lua_call(L, 2, 0);
+    }
+    else
+        lua_call(L, 1, 0);
+
     return 0;
 }
 
@@ -648,7 +823,26 @@ void dfhack_lua_viewscreen::render()
         return;
     }
 
-    safe_call_lua(do_render, 0, 0);
+    if (!track_dirty)
+        safe_call_lua(do_render, 0, 0);
+    else
+    {
+        rect2d area;
+
+        if (beginRender(&area))
+        {
+            auto L = Lua::Core::State;
+            lua_pushinteger(L, area.first.x);
+            lua_pushinteger(L, area.first.y);
+            lua_pushinteger(L, area.second.x);
+            lua_pushinteger(L, area.second.y);
+            safe_call_lua(do_render, 4, 0);
+
+            endRender(&area);
+        }
+        else
+            endRender(NULL);
+    }
 
     dfhack_viewscreen::render();
 }
@@ -681,6 +875,7 @@ void dfhack_lua_viewscreen::feed(std::set<df::interface_key> *keys)
 
 void dfhack_lua_viewscreen::onShow()
 {
+    markDirty();
     lua_pushstring(Lua::Core::State, "onShow");
     safe_call_lua(do_notify, 1, 0);
 }
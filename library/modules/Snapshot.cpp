@@ -0,0 +1,323 @@
+/*
+https://github.com/peterix/dfhack
+Copyright (c) 2009-2012 Petr Mrázek (peterix@gmail.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+
+#include "Internal.h"
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "modules/Snapshot.h"
+#include "modules/World.h"
+#include "modules/Units.h"
+#include "Core.h"
+#include "RemoteTools.h"
+#include "tinythread.h"
+#include "fast_mutex.h"
+
+using namespace DFHack;
+
+#include "DataDefs.h"
+#include "df/world.h"
+#include "df/unit.h"
+#include "df/job.h"
+#include "df/job_list_link.h"
+#include "df/item.h"
+#include "df/report.h"
+#include "df/interfacest.h"
+
+#include "BasicApi.pb.h"
+
+#include <algorithm>
+
+using namespace DFHack::Snapshot;
+using namespace df::enums;
+
+using df::global::world;
+using df::global::gview;
+
+// how many of the latest reports to copy
+static const size_t MAX_ANNOUNCEMENTS = 32;
+
+static const int NUM_PARTS = 6;
+
+// Request counters, one per Contents bit
+static tthread::mutex request_mutex;
+static int request_counts[NUM_PARTS] = { 0, 0, 0, 0, 0, 0 };
+static int requested = 0;
+static bool invalidated = false;
+
+// Only held while copying or replacing the pointer, never while filling data
+static tthread::fast_mutex current_mutex;
+static std::shared_ptr<WorldSnapshot> current;
+
+// The previously published buffer; only touched from the core thread
+static std::shared_ptr<WorldSnapshot> spare;
+static uint32_t serial = 0;
+
+void Snapshot::Request(int contents)
+{
+    tthread::lock_guard<tthread::mutex> lock(request_mutex);
+    for (int i = 0; i < NUM_PARTS; i++)
+    {
+        if ((contents & (1 << i)) && request_counts[i]++ == 0)
+            requested |= (1 << i);
+    }
+}
+
+void Snapshot::Release(int contents)
+{
+    tthread::lock_guard<tthread::mutex> lock(request_mutex);
+    for (int i = 0; i < NUM_PARTS; i++)
+    {
+        if ((contents & (1 << i)) && request_counts[i] > 0 && --request_counts[i] == 0)
+            requested &= ~(1 << i);
+    }
+}
+
+void Snapshot::Invalidate()
+{
+    tthread::lock_guard<tthread::mutex> lock(request_mutex);
+    invalidated = true;
+}
+
+Snapshot::Ptr Snapshot::Get()
+{
+    tthread::lock_guard<tthread::fast_mutex> lock(current_mutex);
+    return current;
+}
+
+void Snapshot::Clear()
+{
+    std::shared_ptr<WorldSnapshot> old;
+    {
+        tthread::lock_guard<tthread::fast_mutex> lock(current_mutex);
+        old.swap(current);
+    }
+    spare.reset();
+}
+
+static void copy_units(WorldSnapshot &snap)
+{
+    auto &units = world->units.active;
+    snap.units.resize(units.size());
+
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        df::unit *unit = units[i];
+        UnitInfo &info = snap.units[i];
+
+        info.id = unit->id;
+        info.pos = unit->pos;
+        info.race = unit->race;
+        info.civ_id = unit->civ_id;
+        info.profession = unit->profession;
+        info.flags1 = unit->flags1.whole;
+        info.flags2 = unit->flags2.whole;
+    }
+}
+
+static void copy_jobs(WorldSnapshot &snap)
+{
+    snap.job_count = 0;
+    snap.jobs_by_type.assign(ENUM_LAST_ITEM(job_type) + 1, 0);
+
+    for (df::job_list_link *link = world->job_list.next; link; link = link->next)
+    {
+        if (!link->item)
+            continue;
+
+        snap.job_count++;
+
+        int type = link->item->job_type;
+        if (type >= 0 && size_t(type) < snap.jobs_by_type.size())
+            snap.jobs_by_type[type]++;
+    }
+}
+
+static void copy_items(WorldSnapshot &snap)
+{
+    snap.items_by_type.assign(ENUM_LAST_ITEM(item_type) + 1, 0);
+
+    auto &items = world->items.all;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        int type = items[i]->getType();
+        if (type >= 0 && size_t(type) < snap.items_by_type.size())
+            snap.items_by_type[type]++;
+    }
+}
+
+static void copy_announcements(WorldSnapshot &snap)
+{
+    auto &reports = gview->announcements.reports;
+    size_t start = reports.size() > MAX_ANNOUNCEMENTS ? reports.size() - MAX_ANNOUNCEMENTS : 0;
+
+    snap.announcements.resize(reports.size() - start);
+
+    for (size_t i = start; i < reports.size(); i++)
+    {
+        df::report *rep = reports[i];
+        AnnouncementInfo &info = snap.announcements[i - start];
+
+        info.text = rep->text;
+        info.color = rep->color;
+        info.bright = rep->bright;
+        info.continuation = rep->flags.bits.continuation;
+    }
+}
+
+static bool compareUnitDetails(const UnitDetails &a, const UnitDetails &b)
+{
+    return a.id < b.id;
+}
+
+static void copy_unit_details(WorldSnapshot &snap)
+{
+    BasicUnitInfoMask mask;
+    mask.set_labors(true);
+    mask.set_skills(true);
+    mask.set_profession(true);
+    mask.set_misc_traits(true);
+
+    auto &units = world->units.all;
+    snap.unit_details.resize(units.size());
+
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        df::unit *unit = units[i];
+        UnitDetails &details = snap.unit_details[i];
+
+        details.id = unit->id;
+        details.race = unit->race;
+        details.civ_id = unit->civ_id;
+        details.dead = Units::isDead(unit);
+        details.alive = Units::isAlive(unit);
+        details.sane = Units::isSane(unit);
+
+        if (details.info && details.info.unique())
+            details.info->Clear();
+        else
+            details.info = std::make_shared<BasicUnitInfo>();
+
+        describeUnit(details.info.get(), unit, &mask);
+    }
+
+    std::sort(snap.unit_details.begin(), snap.unit_details.end(), compareUnitDetails);
+}
+
+static void copy_world_info(WorldSnapshot &snap)
+{
+    if (snap.world_info && snap.world_info.unique())
+        snap.world_info->Clear();
+    else
+        snap.world_info = std::make_shared<GetWorldInfoOut>();
+
+    if (!describeWorldInfo(snap.world_info.get()))
+        snap.world_info.reset();
+}
+
+void Snapshot::Publish()
+{
+    int contents;
+    bool refresh;
+    {
+        tthread::lock_guard<tthread::mutex> lock(request_mutex);
+        contents = requested;
+        refresh = invalidated;
+        invalidated = false;
+    }
+
+    if (!contents || !world)
+    {
+        if (current)
+            Clear();
+        return;
+    }
+
+    if (!gview)
+        contents &= ~ANNOUNCEMENTS;
+
+    uint32_t year = World::ReadCurrentYear();
+    uint32_t year_tick = World::ReadCurrentTick();
+
+    // Nothing moves while the game is paused
+    if (!refresh && current && current->contents == contents &&
+        current->year == year && current->year_tick == year_tick)
+        return;
+
+    // Refill the older buffer if no reader holds it any more,
+    // reusing the capacity of its vectors.
+    std::shared_ptr<WorldSnapshot> next;
+    if (spare && spare.unique())
+        next.swap(spare);
+    else
+        next = std::make_shared<WorldSnapshot>();
+
+    WorldSnapshot &snap = *next;
+    snap.contents = contents;
+    snap.serial = ++serial;
+    snap.year = year;
+    snap.year_tick = year_tick;
+
+    if (contents & UNITS)
+        copy_units(snap);
+    else
+        snap.units.clear();
+
+    if (contents & JOBS)
+        copy_jobs(snap);
+    else
+    {
+        snap.job_count = 0;
+        snap.jobs_by_type.clear();
+    }
+
+    if (contents & ITEMS)
+        copy_items(snap);
+    else
+        snap.items_by_type.clear();
+
+    if (contents & ANNOUNCEMENTS)
+        copy_announcements(snap);
+    else
+        snap.announcements.clear();
+
+    if (contents & UNIT_DETAILS)
+        copy_unit_details(snap);
+    else
+        snap.unit_details.clear();
+
+    if (contents & WORLD_INFO)
+        copy_world_info(snap);
+    else
+        snap.world_info.reset();
+
+    {
+        tthread::lock_guard<tthread::fast_mutex> lock(current_mutex);
+        spare.swap(current);
+        current.swap(next);
+    }
+}
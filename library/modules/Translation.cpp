@@ -27,6 +27,8 @@ distribution.
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstring>
 using namespace std;
 
 #include "modules/Translation.h"
@@ -113,6 +115,77 @@ void addNameWord (string &out, const string &word)
     out.append(Translation::capitalize(word));
 }
 
+/*
+ * Translated names are cached per name object, together with a copy of
+ * the fields they were computed from. A lookup compares the copy with
+ * the current contents, so edits made directly to the structure are
+ * noticed without any hooks; setNickname just drops the entry early.
+ */
+
+struct NameCacheEntry
+{
+    std::string first_name, nickname;
+    int32_t words[7];
+    int16_t parts_of_speech[7];
+    int32_t language;
+    int nickname_mode;
+
+    uint8_t valid;
+    std::string text[4];
+};
+
+static const size_t name_cache_limit = 32768;
+static std::unordered_map<const df::language_name*, NameCacheEntry> name_cache;
+
+template<class S>
+static bool sameString(const std::string &cached, const S &str)
+{
+    return cached.size() == str.size() && memcmp(cached.data(), str.c_str(), str.size()) == 0;
+}
+
+static int getNicknameMode()
+{
+    return (init && gametype) ? int(init->display.nickname[*gametype]) : int(init_nickname_mode::CENTRALIZE);
+}
+
+static bool matchName(const NameCacheEntry &entry, const df::language_name *name, int nick_mode)
+{
+    if (entry.language != name->language || entry.nickname_mode != nick_mode)
+        return false;
+    for (int i = 0; i < 7; i++)
+    {
+        if (entry.words[i] != name->parts[i].word ||
+            entry.parts_of_speech[i] != int16_t(name->parts[i].part_of_speech))
+            return false;
+    }
+    return sameString(entry.first_name, name->first_name) &&
+           sameString(entry.nickname, name->nickname);
+}
+
+static void storeName(NameCacheEntry &entry, const df::language_name *name, int nick_mode)
+{
+    entry.first_name.assign(name->first_name.c_str(), name->first_name.size());
+    entry.nickname.assign(name->nickname.c_str(), name->nickname.size());
+    for (int i = 0; i < 7; i++)
+    {
+        entry.words[i] = name->parts[i].word;
+        entry.parts_of_speech[i] = int16_t(name->parts[i].part_of_speech);
+    }
+    entry.language = name->language;
+    entry.nickname_mode = nick_mode;
+    entry.valid = 0;
+}
+
+static void invalidateName(const df::language_name *name)
+{
+    name_cache.erase(name);
+}
+
+void Translation::ClearCache()
+{
+    name_cache.clear();
+}
+
 void Translation::setNickname(df::language_name *name, std::string nick)
 {
     CHECK_NULL_POINTER(name);
@@ -141,12 +214,12 @@ void Translation::setNickname(df::language_name *name, std::string nick)
         if (!has_words)
             name->has_name = false;
     }
+
+    invalidateName(name);
 }
 
-string Translation::TranslateName(const df::language_name * name, bool inEnglish, bool onlyLastPart)
+static string doTranslateName(const df::language_name * name, bool inEnglish, bool onlyLastPart)
 {
-    CHECK_NULL_POINTER(name);
-
     string out;
     string word;
 
@@ -235,3 +308,32 @@ string Translation::TranslateName(const df::language_name * name, bool inEnglish
 
     return out;
 }
+
+string Translation::TranslateName(const df::language_name * name, bool inEnglish, bool onlyLastPart)
+{
+    CHECK_NULL_POINTER(name);
+
+    int nick_mode = getNicknameMode();
+    int slot = (inEnglish ? 1 : 0) | (onlyLastPart ? 2 : 0);
+
+    auto it = name_cache.find(name);
+    if (it == name_cache.end())
+    {
+        if (name_cache.size() >= name_cache_limit)
+            name_cache.clear();
+
+        it = name_cache.insert(std::make_pair(name, NameCacheEntry())).first;
+        storeName(it->second, name, nick_mode);
+    }
+    else if (!matchName(it->second, name, nick_mode))
+        storeName(it->second, name, nick_mode);
+
+    NameCacheEntry &entry = it->second;
+    if (!(entry.valid & (1 << slot)))
+    {
+        entry.text[slot] = doTranslateName(name, inEnglish, onlyLastPart);
+        entry.valid |= (1 << slot);
+    }
+
+    return entry.text[slot];
+}
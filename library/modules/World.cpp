@@ -48,6 +48,7 @@ using namespace std;
 #include "df/world.h"
 #include "df/historical_figure.h"
 #include "df/map_block.h"
+#include "df/tile_bitmask.h"
 
 using namespace DFHack;
 using namespace df::enums;
@@ -58,6 +59,35 @@ static int next_persistent_id = 0;
 static std::multimap<std::string, int> persistent_index;
 typedef std::pair<std::string, int> T_persistent_item;
 
+/*
+ * Persistent tile masks.
+ *
+ * The masks live in a sparse pool keyed by the owning entry and the map
+ * position of the block. Every owner with masks gets a companion entry
+ * with the key "dfhack/tilemask/<entry_id>", whose string value holds one
+ * fixed-size record per block; the pool is compared against the last
+ * written state once per frame, and changed records are rewritten in place.
+ */
+
+static const size_t tilemask_coord_size = 3*PersistentDataItem::int28_size;
+static const size_t tilemask_row_size = 3*PersistentDataItem::int7_size;
+static const size_t tilemask_record_size = tilemask_coord_size + 16*tilemask_row_size;
+
+struct PersistentTilemask
+{
+    df::tile_bitmask mask;
+    df::tile_bitmask saved;
+    size_t offset;
+};
+
+struct PersistentTilemaskSet
+{
+    PersistentDataItem store;
+    std::map<df::coord, PersistentTilemask> blocks;
+};
+
+static std::map<int, PersistentTilemaskSet> persistent_tilemasks;
+
 bool World::ReadPauseState()
 {
     return DF_GLOBAL_VALUE(pause_state, false);
@@ -159,8 +189,11 @@ void World::ClearPersistentCache()
 {
     next_persistent_id = 0;
     persistent_index.clear();
+    persistent_tilemasks.clear();
 }
 
+static void clearPersistentTilemasks(int entry_id);
+
 static bool BuildPersistentCache()
 {
     if (next_persistent_id)
@@ -317,19 +350,221 @@ bool World::DeletePersistentData(const PersistentDataItem &item)
             hfvec.erase(hfvec.begin()+idx);
         }
 
+        // masks owned by the entry go away with it
+        if (item.key().compare(0, 16, "dfhack/tilemask/") != 0)
+            clearPersistentTilemasks(item.entry_id());
+
         return true;
     }
 
     return false;
 }
 
+static std::string tilemaskStoreKey(int entry_id)
+{
+    return stl_sprintf("dfhack/tilemask/%d", entry_id);
+}
+
+static void writeTilemaskRecord(PersistentDataItem &store, const df::coord &pos, PersistentTilemask &slot)
+{
+    size_t off = slot.offset;
+    store.ensure_data(off, tilemask_record_size);
+
+    store.set_int28(off, pos.x >> 4);
+    store.set_int28(off+4, pos.y >> 4);
+    store.set_int28(off+8, pos.z);
+    off += tilemask_coord_size;
+
+    for (int i = 0; i < 16; i++, off += tilemask_row_size)
+    {
+        uint16_t row = slot.mask.bits[i];
+        store.set_uint7(off, row & 0x7F);
+        store.set_uint7(off+1, (row >> 7) & 0x7F);
+        store.set_uint7(off+2, row >> 14);
+    }
+
+    slot.saved = slot.mask;
+}
+
+static bool readTilemaskRecord(PersistentDataItem &store, size_t off, df::coord *pos, df::tile_bitmask *mask)
+{
+    if (!store.check_data(off, tilemask_record_size))
+        return false;
+
+    pos->x = store.get_int28(off) << 4;
+    pos->y = store.get_int28(off+4) << 4;
+    pos->z = store.get_int28(off+8);
+    off += tilemask_coord_size;
+
+    for (int i = 0; i < 16; i++, off += tilemask_row_size)
+    {
+        mask->bits[i] = store.get_uint7(off) |
+                        (store.get_uint7(off+1) << 7) |
+                        (store.get_uint7(off+2) << 14);
+    }
+
+    return true;
+}
+
+static PersistentTilemaskSet *getTilemaskSet(const PersistentDataItem &item, bool create)
+{
+    if (!item.isValid() || !Core::getInstance().isMapLoaded())
+        return NULL;
+
+    auto it = persistent_tilemasks.find(item.entry_id());
+    if (it != persistent_tilemasks.end())
+        return &it->second;
+
+    auto store = World::GetPersistentData(tilemaskStoreKey(item.entry_id()));
+    if (!store.isValid() && !create)
+        return NULL;
+
+    auto &set = persistent_tilemasks[item.entry_id()];
+    set.store = store;
+
+    if (store.isValid())
+    {
+        size_t count = store.data_size() / tilemask_record_size;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            df::coord pos;
+            df::tile_bitmask mask;
+            if (!readTilemaskRecord(store, i*tilemask_record_size, &pos, &mask))
+                break;
+
+            auto &slot = set.blocks[pos];
+            slot.mask = slot.saved = mask;
+            slot.offset = i*tilemask_record_size;
+        }
+    }
+
+    return &set;
+}
+
+static bool syncTilemaskSet(int entry_id, PersistentTilemaskSet &set)
+{
+    bool any = false;
+    for (auto it = set.blocks.begin(); it != set.blocks.end(); ++it)
+    {
+        if (!set.store.isValid() || memcmp(&it->second.mask, &it->second.saved, sizeof(df::tile_bitmask)) != 0)
+        {
+            any = true;
+            break;
+        }
+    }
+    if (!any)
+        return true;
+
+    if (set.store.isValid())
+        set.store = World::GetPersistentData(set.store.entry_id());
+    if (!set.store.isValid())
+    {
+        set.store = World::AddPersistentData(tilemaskStoreKey(entry_id));
+        if (!set.store.isValid())
+            return false;
+
+        set.store.val().clear();
+        for (auto it = set.blocks.begin(); it != set.blocks.end(); ++it)
+            memset(&it->second.saved, 0xFF, sizeof(df::tile_bitmask));
+    }
+
+    for (auto it = set.blocks.begin(); it != set.blocks.end(); ++it)
+    {
+        if (memcmp(&it->second.mask, &it->second.saved, sizeof(df::tile_bitmask)) != 0)
+            writeTilemaskRecord(set.store, it->first, it->second);
+    }
+
+    return true;
+}
+
+void World::SyncPersistentTilemasks()
+{
+    if (persistent_tilemasks.empty() || !Core::getInstance().isMapLoaded())
+        return;
+
+    for (auto it = persistent_tilemasks.begin(); it != persistent_tilemasks.end(); ++it)
+        syncTilemaskSet(it->first, it->second);
+}
+
 df::tile_bitmask *World::getPersistentTilemask(const PersistentDataItem &item, df::map_block *block, bool create)
 {
-    // this cannot work
-    return NULL;
+    if (!block)
+        return NULL;
+
+    auto set = getTilemaskSet(item, create);
+    if (!set)
+        return NULL;
+
+    auto it = set->blocks.find(block->map_pos);
+    if (it != set->blocks.end())
+        return &it->second.mask;
+    if (!create)
+        return NULL;
+
+    auto &slot = set->blocks[block->map_pos];
+    slot.mask.clear();
+    // force the record to be written out on the next sync
+    memset(&slot.saved, 0xFF, sizeof(df::tile_bitmask));
+    slot.offset = (set->blocks.size()-1) * tilemask_record_size;
+    return &slot.mask;
 }
 
 bool World::deletePersistentTilemask(const PersistentDataItem &item, df::map_block *block)
 {
-    return false;
+    if (!block)
+        return false;
+
+    auto set = getTilemaskSet(item, false);
+    if (!set)
+        return false;
+
+    auto it = set->blocks.find(block->map_pos);
+    if (it == set->blocks.end())
+        return false;
+
+    size_t hole = it->second.offset;
+    size_t last = (set->blocks.size()-1) * tilemask_record_size;
+    set->blocks.erase(it);
+
+    if (set->store.isValid())
+        set->store = GetPersistentData(set->store.entry_id());
+
+    // Keep the records packed: move the last one into the freed slot.
+    for (it = set->blocks.begin(); it != set->blocks.end(); ++it)
+    {
+        if (it->second.offset != last)
+            continue;
+
+        it->second.offset = hole;
+        if (set->store.isValid())
+            writeTilemaskRecord(set->store, it->first, it->second);
+        else
+            memset(&it->second.saved, 0xFF, sizeof(df::tile_bitmask));
+        break;
+    }
+
+    if (set->store.isValid())
+    {
+        if (set->blocks.empty())
+        {
+            DeletePersistentData(set->store);
+            set->store = PersistentDataItem();
+        }
+        else
+            set->store.val().resize(last, '\x01');
+    }
+
+    return true;
+}
+
+static void clearPersistentTilemasks(int entry_id)
+{
+    auto it = persistent_tilemasks.find(entry_id);
+    if (it != persistent_tilemasks.end())
+        persistent_tilemasks.erase(it);
+
+    auto store = World::GetPersistentData(tilemaskStoreKey(entry_id));
+    if (store.isValid())
+        World::DeletePersistentData(store);
 }
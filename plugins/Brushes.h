@@ -4,13 +4,70 @@
 #include <string>
 #include <stack>
 #include <set>
+#include <algorithm>
 
 typedef vector <df::coord> coord_vec;
+
+/**
+ * The part of a brush that falls into one map block:
+ * the block coord (tile coord / 16) and a mask of the affected tiles.
+ */
+struct BrushSpan
+{
+    DFHack::DFCoord block;
+    df::tile_bitmask mask;
+
+    BrushSpan(DFHack::DFCoord block) : block(block) { mask.clear(); }
+
+    DFHack::DFCoord tile(int x, int y) const
+    {
+        return DFHack::DFCoord(block.x*16 + x, block.y*16 + y, block.z);
+    }
+    int count() const
+    {
+        int cnt = 0;
+        for (int y = 0; y < 16; y++)
+            for (uint16_t row = mask.bits[y]; row; row &= row-1)
+                cnt++;
+        return cnt;
+    }
+};
+typedef vector <BrushSpan> span_vec;
+
+inline int countTiles(const span_vec &spans)
+{
+    int cnt = 0;
+    for (size_t i = 0; i < spans.size(); i++)
+        cnt += spans[i].count();
+    return cnt;
+}
+
+/// mask of bits [lo, hi] in a bitmask row
+inline uint16_t rowMask(int lo, int hi)
+{
+    return uint16_t(((2 << hi) - 1) & ~((1 << lo) - 1));
+}
+
 class Brush
 {
 public:
     virtual ~Brush(){};
-    virtual coord_vec points(MapExtras::MapCache & mc,DFHack::DFCoord start) = 0;
+    /// the affected tiles, grouped by map block
+    virtual span_vec spans(MapExtras::MapCache & mc,DFHack::DFCoord start) = 0;
+    /// the affected tiles as a flat list of coordinates
+    coord_vec points(MapExtras::MapCache & mc,DFHack::DFCoord start)
+    {
+        coord_vec v;
+        span_vec sv = spans(mc, start);
+        for (size_t i = 0; i < sv.size(); i++)
+        {
+            for (int x = 0; x < 16; x++)
+                for (int y = 0; y < 16; y++)
+                    if (sv[i].mask.getassignment(x,y))
+                        v.push_back(sv[i].tile(x,y));
+        }
+        return v;
+    }
     virtual std::string str() const {
         return "unknown";
     }
@@ -40,26 +97,32 @@ public:
         y_ = y;
         z_ = z;
     };
-    coord_vec points(MapExtras::MapCache & mc, DFHack::DFCoord start)
+    span_vec spans(MapExtras::MapCache & mc, DFHack::DFCoord start)
     {
-        coord_vec v;
-        DFHack::DFCoord iterstart(start.x - cx_, start.y - cy_, start.z - cz_);
-        DFHack::DFCoord iter = iterstart;
-        for(int xi = 0; xi < x_; xi++)
+        span_vec v;
+        int x1 = std::max(0, start.x - cx_), x2 = std::min<int>(mc.maxTileX() - 1, start.x - cx_ + x_ - 1);
+        int y1 = std::max(0, start.y - cy_), y2 = std::min<int>(mc.maxTileY() - 1, start.y - cy_ + y_ - 1);
+        int z1 = std::max(0, start.z - cz_), z2 = std::min<int>(mc.maxZ() - 1, start.z - cz_ + z_ - 1);
+        if (x1 > x2 || y1 > y2)
+            return v;
+        for(int bx = x1 >> 4; bx <= (x2 >> 4); bx++)
         {
-            for(int yi = 0; yi < y_; yi++)
+            uint16_t row = rowMask(std::max(x1, bx*16) & 15, std::min(x2, bx*16 + 15) & 15);
+            for(int by = y1 >> 4; by <= (y2 >> 4); by++)
             {
-                for(int zi = 0; zi < z_; zi++)
+                int ylo = std::max(y1, by*16) & 15, yhi = std::min(y2, by*16 + 15) & 15;
+                for(int zi = z1; zi <= z2; zi++)
                 {
-                    if(mc.testCoord(iter))
-                        v.push_back(iter);
-                    iter.z++;
+                    DFHack::DFCoord blockc(bx, by, zi);
+                    MapExtras::Block *b = mc.BlockAt(blockc);
+                    if (!b || !b->is_valid())
+                        continue;
+                    BrushSpan span(blockc);
+                    for (int yi = ylo; yi <= yhi; yi++)
+                        span.mask.bits[yi] = row;
+                    v.push_back(span);
                 }
-                iter.z = iterstart.z;
-                iter.y++;
             }
-            iter.y = iterstart.y;
-            iter.x ++;
         }
         return v;
     };
@@ -89,24 +152,14 @@ class BlockBrush : public Brush
 public:
     BlockBrush(){};
     ~BlockBrush(){};
-    coord_vec points(MapExtras::MapCache & mc, DFHack::DFCoord start)
+    span_vec spans(MapExtras::MapCache & mc, DFHack::DFCoord start)
     {
-        coord_vec v;
-        DFHack::DFCoord blockc = start / 16;
-        DFHack::DFCoord iterc = blockc * 16;
+        span_vec v;
         if( !mc.testCoord(start) )
             return v;
-        auto starty = iterc.y;
-        for(int xi = 0; xi < 16; xi++)
-        {
-            for(int yi = 0; yi < 16; yi++)
-            {
-                v.push_back(iterc);
-                iterc.y++;
-            }
-            iterc.y = starty;
-            iterc.x ++;
-        }
+        BrushSpan span(DFHack::DFCoord(start.x >> 4, start.y >> 4, start.z));
+        span.mask.set_all();
+        v.push_back(span);
         return v;
     };
     std::string str() const {
@@ -123,16 +176,18 @@ class ColumnBrush : public Brush
 public:
     ColumnBrush(){};
     ~ColumnBrush(){};
-    coord_vec points(MapExtras::MapCache & mc, DFHack::DFCoord start)
+    span_vec spans(MapExtras::MapCache & mc, DFHack::DFCoord start)
     {
-        coord_vec v;
+        span_vec v;
         bool juststarted = true;
         while (mc.testCoord(start))
         {
             df::tiletype tt = mc.tiletypeAt(start);
             if(DFHack::LowPassable(tt) || juststarted && DFHack::HighPassable(tt))
             {
-                v.push_back(start);
+                BrushSpan span(DFHack::DFCoord(start.x >> 4, start.y >> 4, start.z));
+                span.mask.setassignment(start.x, start.y, true);
+                v.push_back(span);
                 juststarted = false;
                 start.z++;
             }
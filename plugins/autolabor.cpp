@@ -73,6 +73,7 @@ using df::global::world;
  */
 
 DFHACK_PLUGIN_IS_ENABLED(enable_autolabor);
+DFHACK_PLUGIN_UPDATE_CADENCE(update_cadence, 60, 0);
 
 static bool print_debug = 0;
 
@@ -835,7 +836,6 @@ DFhackCExport command_result plugin_onstatechange(color_ostream &out, state_chan
 
 DFhackCExport command_result plugin_onupdate ( color_ostream &out )
 {
-    static int step_count = 0;
     // check run conditions
     if(!world || !world->map.block_index || !enable_autolabor)
     {
@@ -843,10 +843,6 @@ DFhackCExport command_result plugin_onupdate ( color_ostream &out )
         return CR_OK;
     }
 
-    if (++step_count < 60)
-        return CR_OK;
-    step_count = 0;
-
     uint32_t race = ui->race_id;
     uint32_t civ = ui->civ_id;
 
@@ -27,6 +27,7 @@ using namespace df::enums;
 using df::global::world;
 
 DFHACK_PLUGIN("building-hacks");
+DFHACK_PLUGIN_IS_ENABLED(is_enabled);
 struct graphic_tile //could do just 31x31 and be done, but it's nicer to have flexible imho.
 {
     int16_t tile; //originally uint8_t but we need to indicate non-animated tiles
@@ -47,15 +48,28 @@ struct workshop_hack_data
     int frame_skip; // e.g. 2 means have to ticks between frames
     //updateCallback:
     int skip_updates;
+    bool batch_updates; // collect due shops and fire onUpdateActionBatch once per frame
+    int update_phase; // offset of the update frame, spreads batched definitions over frames
 };
 typedef std::map<int32_t,workshop_hack_data> workshops_data_t;
 workshops_data_t hacked_workshops;
+std::vector<int32_t> pending_updates; // ids of batched shops due this tick
 
 static void handle_update_action(color_ostream &out,df::building_workshopst*){};
 
 DEFINE_LUA_EVENT_1(onUpdateAction,handle_update_action,df::building_workshopst*);
+static Lua::Notification onUpdateActionBatch_event;
+static void onUpdateActionBatch(color_ostream &out,const std::vector<df::building_workshopst*> &shops)
+{
+    if (auto state = onUpdateActionBatch_event.state_if_count())
+    {
+        Lua::PushVector(state, shops);
+        onUpdateActionBatch_event.invoke(out, 1);
+    }
+}
 DFHACK_PLUGIN_LUA_EVENTS {
     DFHACK_LUA_EVENT(onUpdateAction),
+    DFHACK_LUA_EVENT(onUpdateActionBatch),
     DFHACK_LUA_END
 };
 struct work_hook : df::building_workshopst{
@@ -181,7 +195,12 @@ struct work_hook : df::building_workshopst{
             if(def->skip_updates!=0 && is_fully_built())
             {
                 df::world* world = df::global::world;
-                if(world->frame_counter % def->skip_updates == 0)
+                if(def->batch_updates)
+                {
+                    if((world->frame_counter + def->update_phase) % def->skip_updates == 0)
+                        pending_updates.push_back(id);
+                }
+                else if(world->frame_counter % def->skip_updates == 0)
                 {
                     CoreSuspendClaimer suspend;
                     color_ostream_proxy out(Core::getInstance().getConsole());
@@ -248,6 +267,7 @@ IMPLEMENT_VMETHOD_INTERPOSE(work_hook, drawBuilding);
 void clear_mapping()
 {
     hacked_workshops.clear();
+    pending_updates.clear();
 }
 static void loadFrames(lua_State* L,workshop_hack_data& def,int stack_pos)
 {
@@ -298,7 +318,7 @@ static void loadFrames(lua_State* L,workshop_hack_data& def,int stack_pos)
     return ;
 }
 //arguments: custom type,impassible fix (bool), consumed power, produced power, list of connection points, update skip(0/nil to disable)
-//          table of frames,frame to tick ratio (-1 for machine control)
+//          table of frames,frame to tick ratio (-1 for machine control),batch updates (bool)
 static int addBuilding(lua_State* L)
 {
     workshop_hack_data newDefinition;
@@ -326,6 +346,10 @@ static int addBuilding(lua_State* L)
     lua_pop(L,1);
     //updates
     newDefinition.skip_updates=luaL_optinteger(L,6,0);
+    newDefinition.batch_updates=lua_toboolean(L,9);
+    newDefinition.update_phase=0;
+    if(newDefinition.batch_updates && newDefinition.skip_updates>0)
+        newDefinition.update_phase=newDefinition.myType % newDefinition.skip_updates;
     //animation
     if(!lua_isnil(L,7))
     {
@@ -376,14 +400,35 @@ DFhackCExport command_result plugin_onstatechange(color_ostream &out, state_chan
 
     return CR_OK;
 }
+DFhackCExport command_result plugin_onupdate ( color_ostream &out )
+{
+    if (pending_updates.empty())
+        return CR_OK;
+
+    // shops may have been removed later in the same tick, so look them up again
+    std::vector<df::building_workshopst*> shops;
+    for (size_t i = 0; i < pending_updates.size(); i++)
+    {
+        auto shop = strict_virtual_cast<df::building_workshopst>(df::building::find(pending_updates[i]));
+        if (shop)
+            shops.push_back(shop);
+    }
+    pending_updates.clear();
+
+    if (!shops.empty())
+        onUpdateActionBatch(out,shops);
+    return CR_OK;
+}
 DFhackCExport command_result plugin_init ( color_ostream &out, std::vector <PluginCommand> &commands)
 {
     enable_hooks(true);
+    is_enabled = true;
     return CR_OK;
 }
 
 DFhackCExport command_result plugin_shutdown ( color_ostream &out )
 {
+    is_enabled = false;
     plugin_onstatechange(out,SC_WORLD_UNLOADED);
     return CR_OK;
 }
@@ -0,0 +1,175 @@
+// Times some library hot paths against the loaded world.
+// Results can be appended to a tab-separated file to track them over time.
+// The benchmarks live in library/bench, shared with dfhack-bench, which
+// runs them against a synthetic world without DF.
+
+#include "Core.h"
+#include "Console.h"
+#include "Export.h"
+#include "PluginManager.h"
+#include "MemAccess.h"
+#include "VersionInfo.h"
+#include "LuaTools.h"
+#include "Benchmarks.h"
+
+#include "modules/Maps.h"
+
+#include <fstream>
+#include <algorithm>
+
+using std::vector;
+using std::string;
+
+using namespace DFHack;
+
+DFHACK_PLUGIN("benchmark");
+
+// Throws away the output of commands run in a loop
+class discard_ostream : public buffered_color_ostream {
+protected:
+    virtual void flush_proxy() { buffer.clear(); }
+};
+
+static void log_result(std::ofstream &log, const string &name, int iterations, size_t items, uint32_t total)
+{
+    Benchmarks::logResult(log, Core::getInstance().vinfo->getVersion(), name, iterations, items, total);
+}
+
+// Runs a command repeatedly, e.g. to profile a plugin against a large fort
+static command_result bench_command(color_ostream &out, std::ofstream &log, int iterations,
+                                    vector<string> &command)
+{
+    string name = command[0];
+    command.erase(command.begin());
+
+    discard_ostream null_out;
+    Process *p = Core::getInstance().p;
+
+    uint32_t start = p->getTickCount();
+    for (int i = 0; i < iterations; i++)
+    {
+        command_result rv = Core::getInstance().runCommand(null_out, name, command);
+        null_out.flush();
+
+        if (rv != CR_OK)
+        {
+            out.printerr("%s failed in iteration %d: %d\n", name.c_str(), i+1, rv);
+            return CR_FAILURE;
+        }
+    }
+    uint32_t total = p->getTickCount() - start;
+
+    out.print("%-20s %d runs: %u ms (%.3f ms per run)\n",
+              name.c_str(), iterations, total, double(total) / iterations);
+    log_result(log, "command:" + name, iterations, 1, total);
+    return CR_OK;
+}
+
+command_result df_benchmark (color_ostream &out, vector <string> & parameters)
+{
+    int iterations = 10;
+    string outfile;
+    vector<string> names;
+    vector<string> command;
+
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        if (parameters[i] == "-n" && i+1 < parameters.size())
+            iterations = atoi(parameters[++i].c_str());
+        else if (parameters[i] == "-o" && i+1 < parameters.size())
+            outfile = parameters[++i];
+        else if (parameters[i][0] == '-')
+            return CR_WRONG_USAGE;
+        else if (parameters[i] == "command" && names.empty())
+        {
+            // everything else belongs to the command
+            command.assign(parameters.begin()+i+1, parameters.end());
+            if (command.empty())
+                return CR_WRONG_USAGE;
+            break;
+        }
+        else
+            names.push_back(parameters[i]);
+    }
+
+    if (iterations <= 0)
+        return CR_WRONG_USAGE;
+
+    CoreSuspender suspend;
+
+    if (!Core::getInstance().isWorldLoaded())
+    {
+        out.printerr("A world must be loaded.\n");
+        return CR_FAILURE;
+    }
+
+    std::ofstream log;
+    if (!outfile.empty())
+    {
+        log.open(outfile.c_str(), std::ios::out | std::ios::app);
+        if (!log.good())
+        {
+            out.printerr("Could not open %s\n", outfile.c_str());
+            return CR_FAILURE;
+        }
+    }
+
+    if (!command.empty())
+        return bench_command(out, log, iterations, command);
+
+    Process *p = Core::getInstance().p;
+    auto L = Lua::Core::State;
+
+    for (const Benchmarks::Benchmark *bench = Benchmarks::list; bench->name; bench++)
+    {
+        if (!names.empty() && std::find(names.begin(), names.end(), bench->name) == names.end())
+            continue;
+
+        if (bench->need_map && !Maps::IsValid())
+        {
+            out.print("%-20s skipped: no map loaded\n", bench->name);
+            continue;
+        }
+
+        // warm up caches before timing
+        size_t items = bench->fn(out, L);
+
+        uint32_t start = p->getTickCount();
+        for (int i = 0; i < iterations; i++)
+            bench->fn(out, L);
+        uint32_t total = p->getTickCount() - start;
+
+        out.print("%-20s %d x %d items: %u ms (%.3f ms per iteration)\n",
+                  bench->name, iterations, int(items), total, double(total) / iterations);
+
+        log_result(log, bench->name, iterations, items, total);
+    }
+
+    return CR_OK;
+}
+
+DFhackCExport command_result plugin_init ( color_ostream &out, std::vector <PluginCommand> &commands)
+{
+    commands.push_back(PluginCommand(
+        "benchmark", "Time library hot paths against the loaded world.",
+        df_benchmark, false,
+        "  benchmark [-n iterations] [-o file] [name...]\n"
+        "    Runs each benchmark (or only the named ones) the given number\n"
+        "    of times, 10 by default, after one untimed warm-up run.\n"
+        "    Benchmarks: mapcache, similar-tiletype, translate-name,\n"
+        "    translate-name-cold, lua-fields, rpc-units.\n"
+        "  benchmark [-n iterations] [-o file] command cmd [args...]\n"
+        "    Runs a command the given number of times with its output\n"
+        "    discarded, e.g. 'benchmark -n 50 command prospect all' to\n"
+        "    profile a plugin against the loaded fort.\n"
+        "    With -o, appends one tab-separated line per benchmark to the\n"
+        "    file: time, dfhack version, df version, name, iterations,\n"
+        "    items per iteration, total milliseconds.\n"
+    ));
+    return CR_OK;
+}
+
+DFhackCExport command_result plugin_shutdown ( color_ostream &out )
+{
+    return CR_OK;
+}
@@ -5,6 +5,7 @@
 #include <PluginManager.h>
 #include <string.h>
 #include <stdexcept>
+#include <set>
 
 #include <VTableInterpose.h>
 
@@ -22,6 +23,7 @@
 
 #include "df/proj_itemst.h"
 #include "df/proj_unitst.h"
+#include "df/proj_list_link.h"
 
 #include "MiscUtils.h"
 #include "LuaTools.h"
@@ -45,6 +47,7 @@ using df::global::ui;
 typedef df::reaction_product_itemst item_product;
 
 DFHACK_PLUGIN("eventful");
+DFHACK_PLUGIN_IS_ENABLED(is_enabled);
 
 struct ReagentSource {
     int idx;
@@ -133,6 +136,65 @@ DEFINE_LUA_EVENT_1(onConstructionCreatedDestroyed, handle_constructions, df::con
 DEFINE_LUA_EVENT_2(onSyndrome, handle_syndrome, int32_t,int32_t);
 DEFINE_LUA_EVENT_1(onInvasion,handle_int32t,int32_t);
 DEFINE_LUA_EVENT_4(onInventoryChange,handle_inventory_change,int32_t,int32_t,df::unit_inventory_item*,df::unit_inventory_item*);
+
+/*
+ * Batched events: when enabled, occurrences are queued during the tick and
+ * delivered once per frame as a single array. Queues are only touched from
+ * the main thread (vmethod hooks, EventManager and plugin_onupdate).
+ */
+enum batch_type {
+    BATCH_PROJ_ITEM_MOVEMENT,
+    BATCH_PROJ_UNIT_MOVEMENT,
+    BATCH_BUILDING,
+    BATCH_UNIT_DEATH,
+    BATCH_ITEM_CREATED,
+    BATCH_SYNDROME,
+    BATCH_INVASION,
+    BATCH_MAX
+};
+struct event_batch {
+    const char *name; // name of the immediate event
+    int arity; // queued values per occurrence
+    Lua::Notification *event;
+    bool enabled;
+    int limit; // max occurrences queued per frame, 0 for no limit
+    int dropped; // dropped this frame
+    int dropped_total;
+    std::vector<intptr_t> queue;
+};
+static Lua::Notification onProjItemCheckMovementBatch_event;
+static Lua::Notification onProjUnitCheckMovementBatch_event;
+static Lua::Notification onBuildingCreatedDestroyedBatch_event;
+static Lua::Notification onUnitDeathBatch_event;
+static Lua::Notification onItemCreatedBatch_event;
+static Lua::Notification onSyndromeBatch_event;
+static Lua::Notification onInvasionBatch_event;
+static event_batch batches[BATCH_MAX] = {
+    { "onProjItemCheckMovement", 1, &onProjItemCheckMovementBatch_event },
+    { "onProjUnitCheckMovement", 1, &onProjUnitCheckMovementBatch_event },
+    { "onBuildingCreatedDestroyed", 1, &onBuildingCreatedDestroyedBatch_event },
+    { "onUnitDeath", 1, &onUnitDeathBatch_event },
+    { "onItemCreated", 1, &onItemCreatedBatch_event },
+    { "onSyndrome", 2, &onSyndromeBatch_event },
+    { "onInvasion", 1, &onInvasionBatch_event },
+};
+static bool queue_event(batch_type type, intptr_t a, intptr_t b = 0)
+{
+    event_batch &batch = batches[type];
+    if (!batch.enabled)
+        return false;
+    if (batch.limit > 0 && batch.queue.size() >= size_t(batch.limit * batch.arity))
+    {
+        batch.dropped++;
+        batch.dropped_total++;
+        return true;
+    }
+    batch.queue.push_back(a);
+    if (batch.arity > 1)
+        batch.queue.push_back(b);
+    return true;
+}
+
 DFHACK_PLUGIN_LUA_EVENTS {
     DFHACK_LUA_EVENT(onWorkshopFillSidebarMenu),
     DFHACK_LUA_EVENT(postWorkshopFillSidebarMenu),
@@ -152,6 +214,14 @@ DFHACK_PLUGIN_LUA_EVENTS {
     DFHACK_LUA_EVENT(onSyndrome),
     DFHACK_LUA_EVENT(onInvasion),
     DFHACK_LUA_EVENT(onInventoryChange),
+    /*  batched events */
+    DFHACK_LUA_EVENT(onProjItemCheckMovementBatch),
+    DFHACK_LUA_EVENT(onProjUnitCheckMovementBatch),
+    DFHACK_LUA_EVENT(onBuildingCreatedDestroyedBatch),
+    DFHACK_LUA_EVENT(onUnitDeathBatch),
+    DFHACK_LUA_EVENT(onItemCreatedBatch),
+    DFHACK_LUA_EVENT(onSyndromeBatch),
+    DFHACK_LUA_EVENT(onInvasionBatch),
     DFHACK_LUA_END
 };
 
@@ -168,11 +238,13 @@ void ev_mng_jobCompleted(color_ostream& out, void* job)
 void ev_mng_unitDeath(color_ostream& out, void* ptr)
 {
     int32_t myId=int32_t(ptr);
+    queue_event(BATCH_UNIT_DEATH,myId);
     onUnitDeath(out,myId);
 }
 void ev_mng_itemCreate(color_ostream& out, void* ptr)
 {
     int32_t myId=int32_t(ptr);
+    queue_event(BATCH_ITEM_CREATED,myId);
     onItemCreated(out,myId);
 }
 void ev_mng_construction(color_ostream& out, void* ptr)
@@ -183,16 +255,19 @@ void ev_mng_construction(color_ostream& out, void* ptr)
 void ev_mng_syndrome(color_ostream& out, void* ptr)
 {
     EventManager::SyndromeData* data=reinterpret_cast<EventManager::SyndromeData*>(ptr);
+    queue_event(BATCH_SYNDROME,data->unitId,data->syndromeIndex);
     onSyndrome(out,data->unitId,data->syndromeIndex);
 }
 void ev_mng_invasion(color_ostream& out, void* ptr)
 {
     int32_t myId=int32_t(ptr);
+    queue_event(BATCH_INVASION,myId);
     onInvasion(out,myId);
 }
 static void ev_mng_building(color_ostream& out, void* ptr)
 {
     int32_t myId=int32_t(ptr);
+    queue_event(BATCH_BUILDING,myId);
     onBuildingCreatedDestroyed(out,myId);
 }
 static void ev_mng_inventory(color_ostream& out, void* ptr)
@@ -244,8 +319,39 @@ static void enableEvent(int evType,int freq)
     EventManager::registerListener(typeToEnable,EventManager::EventHandler(fun_ptr,freq),plugin_self);
     enabledEventManagerEvents[typeToEnable] = freq;
 }
+static event_batch *find_batch(const std::string &name)
+{
+    for (int i = 0; i < BATCH_MAX; i++)
+        if (name == batches[i].name)
+            return &batches[i];
+    return NULL;
+}
+static void enableEventBatch(std::string name,int limit)
+{
+    event_batch *batch = find_batch(name);
+    CHECK_INVALID_ARGUMENT(batch && limit >= 0);
+    batch->enabled = true;
+    batch->limit = limit;
+}
+static void disableEventBatch(std::string name)
+{
+    event_batch *batch = find_batch(name);
+    CHECK_INVALID_ARGUMENT(batch);
+    batch->enabled = false;
+    batch->queue.clear();
+    batch->dropped = 0;
+}
+static int getEventBatchDropped(std::string name)
+{
+    event_batch *batch = find_batch(name);
+    CHECK_INVALID_ARGUMENT(batch);
+    return batch->dropped_total;
+}
 DFHACK_PLUGIN_LUA_FUNCTIONS{
     DFHACK_LUA_FUNCTION(enableEvent),
+    DFHACK_LUA_FUNCTION(enableEventBatch),
+    DFHACK_LUA_FUNCTION(disableEventBatch),
+    DFHACK_LUA_FUNCTION(getEventBatchDropped),
     DFHACK_LUA_END
 };
 struct workshop_hook : df::building_workshopst{
@@ -316,9 +422,13 @@ struct proj_item_hook: df::proj_itemst{
     }
     DEFINE_VMETHOD_INTERPOSE(bool,checkMovement,())
     {
-        CoreSuspendClaimer suspend;
-        color_ostream_proxy out(Core::getInstance().getConsole());
-        onProjItemCheckMovement(out,this);
+        queue_event(BATCH_PROJ_ITEM_MOVEMENT,intptr_t(this));
+        if (onProjItemCheckMovement_event.get_listener_count())
+        {
+            CoreSuspendClaimer suspend;
+            color_ostream_proxy out(Core::getInstance().getConsole());
+            onProjItemCheckMovement(out,this);
+        }
         return INTERPOSE_NEXT(checkMovement)();
     }
 };
@@ -336,9 +446,13 @@ struct proj_unit_hook: df::proj_unitst{
     }
     DEFINE_VMETHOD_INTERPOSE(bool,checkMovement,())
     {
-        CoreSuspendClaimer suspend;
-        color_ostream_proxy out(Core::getInstance().getConsole());
-        onProjUnitCheckMovement(out,this);
+        queue_event(BATCH_PROJ_UNIT_MOVEMENT,intptr_t(this));
+        if (onProjUnitCheckMovement_event.get_listener_count())
+        {
+            CoreSuspendClaimer suspend;
+            color_ostream_proxy out(Core::getInstance().getConsole());
+            onProjUnitCheckMovement(out,this);
+        }
         return INTERPOSE_NEXT(checkMovement)();
     }
 };
@@ -418,6 +532,77 @@ static void world_specific_hooks(color_ostream &out,bool enable)
         products.clear();
     }
 }
+static void clear_batches()
+{
+    for (int i = 0; i < BATCH_MAX; i++)
+    {
+        batches[i].queue.clear();
+        batches[i].dropped = 0;
+    }
+}
+static void push_batch(lua_State *L, batch_type type, std::set<df::projectile*> &live)
+{
+    event_batch &batch = batches[type];
+    lua_newtable(L);
+    int n = 0;
+    for (size_t i = 0; i < batch.queue.size(); i += batch.arity)
+    {
+        switch (type)
+        {
+        case BATCH_PROJ_ITEM_MOVEMENT:
+        case BATCH_PROJ_UNIT_MOVEMENT:
+            // skip projectiles that are gone, and repeated moves in the same frame
+            if (!live.erase((df::projectile*)batch.queue[i]))
+                continue;
+            if (type == BATCH_PROJ_ITEM_MOVEMENT)
+                Lua::Push(L, (df::proj_itemst*)batch.queue[i]);
+            else
+                Lua::Push(L, (df::proj_unitst*)batch.queue[i]);
+            break;
+        case BATCH_SYNDROME:
+            lua_createtable(L, 2, 0);
+            lua_pushinteger(L, batch.queue[i]);
+            lua_rawseti(L, -2, 1);
+            lua_pushinteger(L, batch.queue[i+1]);
+            lua_rawseti(L, -2, 2);
+            break;
+        default:
+            lua_pushinteger(L, batch.queue[i]);
+            break;
+        }
+        lua_rawseti(L, -2, ++n);
+    }
+}
+static void deliver_batches(color_ostream &out)
+{
+    std::set<df::projectile*> live;
+    bool live_scanned = false;
+
+    for (int i = 0; i < BATCH_MAX; i++)
+    {
+        event_batch &batch = batches[i];
+        if (batch.queue.empty() && !batch.dropped)
+            continue;
+
+        lua_State *L = batch.event->state_if_count();
+        if (L)
+        {
+            if ((i == BATCH_PROJ_ITEM_MOVEMENT || i == BATCH_PROJ_UNIT_MOVEMENT) && !live_scanned)
+            {
+                for (auto link = world->proj_list.next; link; link = link->next)
+                    live.insert(link->item);
+                live_scanned = true;
+            }
+
+            push_batch(L, batch_type(i), live);
+            lua_pushinteger(L, batch.dropped);
+            batch.event->invoke(out, 2);
+        }
+
+        batch.queue.clear();
+        batch.dropped = 0;
+    }
+}
 void disable_all_hooks(color_ostream &out)
 {
     world_specific_hooks(out,false);
@@ -431,7 +616,7 @@ DFhackCExport command_result plugin_onstatechange(color_ostream &out, state_chan
         break;
     case SC_WORLD_UNLOADED:
         world_specific_hooks(out,false);
-        
+        clear_batches();
         break;
     default:
         break;
@@ -440,16 +625,24 @@ DFhackCExport command_result plugin_onstatechange(color_ostream &out, state_chan
     return CR_OK;
 }
 
+DFhackCExport command_result plugin_onupdate ( color_ostream &out )
+{
+    deliver_batches(out);
+    return CR_OK;
+}
+
 DFhackCExport command_result plugin_init ( color_ostream &out, std::vector <PluginCommand> &commands)
 {
     if (Core::getInstance().isWorldLoaded())
         plugin_onstatechange(out, SC_WORLD_LOADED);
     enable_hooks(true);
+    is_enabled = true;
     return CR_OK;
 }
 
 DFhackCExport command_result plugin_shutdown ( color_ostream &out )
 {
+    is_enabled = false;
     disable_all_hooks(out);
     return CR_OK;
 }
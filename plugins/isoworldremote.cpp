@@ -36,12 +36,12 @@ using namespace isoworldremote;
 // mostly to allow having the mandatory stuff on top of the file and commands on the bottom
 command_result isoWorldRemote (color_ostream &out, std::vector <std::string> & parameters);
 
-static command_result GetEmbarkTile(color_ostream &stream, const TileRequest *in, EmbarkTile *out);
+static command_result GetEmbarkTile(color_ostream &stream, const TileRequest *in, EmbarkTile *out, RPCReplyStream *reply);
 static command_result GetEmbarkInfo(color_ostream &stream, const MapRequest *in, MapReply *out);
 static command_result GetRawNames(color_ostream &stream, const MapRequest *in, RawNames *out);
 
 bool gather_embark_tile_layer(int EmbX, int EmbY, int EmbZ, EmbarkTileLayer * tile, MapExtras::MapCache * MP);
-bool gather_embark_tile(int EmbX, int EmbY, EmbarkTile * tile, MapExtras::MapCache * MP);
+bool gather_embark_tile(int EmbX, int EmbY, EmbarkTile * tile, MapExtras::MapCache * MP, RPCReplyStream * layers = NULL);
 
 
 // A plugin must be able to return its name and version.
@@ -167,10 +167,10 @@ DFhackCExport command_result plugin_onupdate ( color_ostream &out )
 //    return CR_OK;
 //}
 
-static command_result GetEmbarkTile(color_ostream &stream, const TileRequest *in, EmbarkTile *out)
+static command_result GetEmbarkTile(color_ostream &stream, const TileRequest *in, EmbarkTile *out, RPCReplyStream *reply)
 {
     MapExtras::MapCache MC;
-    gather_embark_tile(in->want_x() * 3, in->want_y() * 3, out, &MC);
+    gather_embark_tile(in->want_x() * 3, in->want_y() * 3, out, &MC, reply);
     MC.trash();
     return CR_OK;
 }
@@ -219,7 +219,7 @@ int coord_to_index_48(int x, int y) {
     return y*48+x;
 }
 
-bool gather_embark_tile(int EmbX, int EmbY, EmbarkTile * tile, MapExtras::MapCache * MP) {
+bool gather_embark_tile(int EmbX, int EmbY, EmbarkTile * tile, MapExtras::MapCache * MP, RPCReplyStream * layers) {
     tile->set_is_valid(false);
     tile->set_world_x(df::global::world->map.region_x + (EmbX/3)); 
     tile->set_world_y(df::global::world->map.region_y + (EmbY/3)); 
@@ -227,10 +227,15 @@ bool gather_embark_tile(int EmbX, int EmbY, EmbarkTile * tile, MapExtras::MapCac
     tile->set_current_year(*df::global::cur_year);
     tile->set_current_season(*df::global::cur_season);
     int num_valid_layers = 0;
+    EmbarkTileLayer streamed_layer; // reused for every layer when streaming
     for(int z = 0; z < MP->maxZ(); z++)
     {
-        EmbarkTileLayer * tile_layer = tile->add_tile_layer();
+        EmbarkTileLayer * tile_layer = layers ? &streamed_layer : tile->add_tile_layer();
+        if(layers)
+            tile_layer->Clear();
         num_valid_layers += gather_embark_tile_layer(EmbX, EmbY, z, tile_layer, MP);
+        if(layers)
+            layers->add(EmbarkTile::kTileLayerFieldNumber, *tile_layer);
     }
     if(num_valid_layers > 0)
         tile->set_is_valid(true);
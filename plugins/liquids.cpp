@@ -437,186 +437,168 @@ command_result df_liquids_execute(color_ostream &out, OperationMode &cur_mode, d
     }
 
     MapCache mcache;
-    coord_vec all_tiles = brush->points(mcache,cursor);
+    span_vec all_spans = brush->spans(mcache,cursor);
 
     // Force the game to recompute its walkability cache
     df::global::world->reindex_pathfinding = true;
 
-    switch (cur_mode.paint)
+    for (span_vec::iterator iter = all_spans.begin(); iter != all_spans.end(); ++iter)
     {
-    case P_OBSIDIAN:
-        {
-            coord_vec::iterator iter = all_tiles.begin();
-            while (iter != all_tiles.end())
-            {
-                mcache.setTiletypeAt(*iter, tiletype::LavaWall);
-                mcache.setTemp1At(*iter,10015);
-                mcache.setTemp2At(*iter,10015);
-                df::tile_designation des = mcache.designationAt(*iter);
-                des.bits.flow_size = 0;
-                des.bits.flow_forbid = false;
-                mcache.setDesignationAt(*iter, des);
-                iter ++;
-            }
-            break;
-        }
-    case P_OBSIDIAN_FLOOR:
-        {
-            coord_vec::iterator iter = all_tiles.begin();
-            while (iter != all_tiles.end())
-            {
-                mcache.setTiletypeAt(*iter, findRandomVariant(tiletype::LavaFloor1));
-                iter ++;
-            }
-            break;
-        }
-    case P_RIVER_SOURCE:
-        {
-            coord_vec::iterator iter = all_tiles.begin();
-            while (iter != all_tiles.end())
-            {
-                mcache.setTiletypeAt(*iter, tiletype::RiverSource);
-
-                df::tile_designation a = mcache.designationAt(*iter);
-                a.bits.liquid_type = tile_liquid::Water;
-                a.bits.liquid_static = false;
-                a.bits.flow_size = 7;
-                mcache.setTemp1At(*iter,10015);
-                mcache.setTemp2At(*iter,10015);
-                mcache.setDesignationAt(*iter,a);
+        // check if the block is actually there
+        Block *block = mcache.BlockAt(iter->block);
+        if (!block)
+            continue;
 
-                Block * b = mcache.BlockAt((*iter)/16);
-                b->enableBlockUpdates(true);
+        auto raw_block = block->getRaw();
+        bool updated = false;
 
-                iter++;
-            }
-            break;
-        }
-    case P_WCLEAN:
+        for (int y = 0; y < 16; y++)
         {
-            coord_vec::iterator iter = all_tiles.begin();
-            while (iter != all_tiles.end())
+            uint16_t row = iter->mask.bits[y];
+            for (int x = 0; row && x < 16; x++)
             {
-                DFHack::DFCoord current = *iter;
-                df::tile_designation des = mcache.designationAt(current);
-                des.bits.water_salt = false;
-                des.bits.water_stagnant = false;
-                mcache.setDesignationAt(current,des);
-                iter++;
-            }
-            break;
-        }
-    case P_MAGMA:
-    case P_WATER:
-    case P_FLOW_BITS:
-        {
-            set <Block *> seen_blocks;
-            coord_vec::iterator iter = all_tiles.begin();
-            while (iter != all_tiles.end())
-            {
-                DFHack::DFCoord current = *iter; // current tile coord
-                DFHack::DFCoord curblock = current /16; // current block coord
-                // check if the block is actually there
-                auto block = mcache.BlockAt(curblock);
-                if(!block)
-                {
-                    iter ++;
-                    continue;
-                }
-                auto raw_block = block->getRaw();
-                df::tile_designation des = mcache.designationAt(current);
-                df::tiletype tt = mcache.tiletypeAt(current);
-                // don't put liquids into places where they don't belong...
-                if(!DFHack::FlowPassable(tt))
-                {
-                    iter++;
+                if (!(row & (1 << x)))
                     continue;
-                }
-                if(cur_mode.paint != P_FLOW_BITS)
+                row &= ~(1 << x);
+                df::coord2d current(x, y);
+
+                switch (cur_mode.paint)
                 {
-                    unsigned old_amount = des.bits.flow_size;
-                    unsigned new_amount = old_amount;
-                    df::tile_liquid old_liquid = des.bits.liquid_type;
-                    df::tile_liquid new_liquid = old_liquid;
-                    // Compute new liquid type and amount
-                    switch (cur_mode.setmode)
+                case P_OBSIDIAN:
                     {
-                    case M_KEEP:
-                        new_amount = cur_mode.amount;
+                        block->setTiletypeAt(current, tiletype::LavaWall);
+                        block->setTemp1At(current,10015);
+                        block->setTemp2At(current,10015);
+                        df::tile_designation des = block->DesignationAt(current);
+                        des.bits.flow_size = 0;
+                        des.bits.flow_forbid = false;
+                        block->setDesignationAt(current, des);
                         break;
-                    case M_INC:
-                        if(old_amount < cur_mode.amount)
-                            new_amount = cur_mode.amount;
+                    }
+                case P_OBSIDIAN_FLOOR:
+                    block->setTiletypeAt(current, findRandomVariant(tiletype::LavaFloor1));
+                    break;
+                case P_RIVER_SOURCE:
+                    {
+                        block->setTiletypeAt(current, tiletype::RiverSource);
+
+                        df::tile_designation a = block->DesignationAt(current);
+                        a.bits.liquid_type = tile_liquid::Water;
+                        a.bits.liquid_static = false;
+                        a.bits.flow_size = 7;
+                        block->setTemp1At(current,10015);
+                        block->setTemp2At(current,10015);
+                        block->setDesignationAt(current,a);
+                        updated = true;
+                        break;
+                    }
+                case P_WCLEAN:
+                    {
+                        df::tile_designation des = block->DesignationAt(current);
+                        des.bits.water_salt = false;
+                        des.bits.water_stagnant = false;
+                        block->setDesignationAt(current,des);
                         break;
-                    case M_DEC:
-                        if (old_amount > cur_mode.amount)
-                            new_amount = cur_mode.amount;
                     }
-                    if (cur_mode.paint == P_MAGMA)
-                        new_liquid = tile_liquid::Magma;
-                    else if (cur_mode.paint == P_WATER)
-                        new_liquid = tile_liquid::Water;
-                    // Store new amount and type
-                    des.bits.flow_size = new_amount;
-                    des.bits.liquid_type = new_liquid;
-                    // Compute temperature
-                    if (!old_amount)
-                        old_liquid = tile_liquid::Water;
-                    if (!new_amount)
-                        new_liquid = tile_liquid::Water;
-                    if (old_liquid != new_liquid)
+                case P_MAGMA:
+                case P_WATER:
+                case P_FLOW_BITS:
                     {
-                        if (new_liquid == tile_liquid::Water)
+                        df::tile_designation des = block->DesignationAt(current);
+                        df::tiletype tt = block->tiletypeAt(current);
+                        // don't put liquids into places where they don't belong...
+                        if(!DFHack::FlowPassable(tt))
+                            break;
+                        if(cur_mode.paint != P_FLOW_BITS)
                         {
-                            mcache.setTemp1At(current,10015);
-                            mcache.setTemp2At(current,10015);
+                            unsigned old_amount = des.bits.flow_size;
+                            unsigned new_amount = old_amount;
+                            df::tile_liquid old_liquid = des.bits.liquid_type;
+                            df::tile_liquid new_liquid = old_liquid;
+                            // Compute new liquid type and amount
+                            switch (cur_mode.setmode)
+                            {
+                            case M_KEEP:
+                                new_amount = cur_mode.amount;
+                                break;
+                            case M_INC:
+                                if(old_amount < cur_mode.amount)
+                                    new_amount = cur_mode.amount;
+                                break;
+                            case M_DEC:
+                                if (old_amount > cur_mode.amount)
+                                    new_amount = cur_mode.amount;
+                            }
+                            if (cur_mode.paint == P_MAGMA)
+                                new_liquid = tile_liquid::Magma;
+                            else if (cur_mode.paint == P_WATER)
+                                new_liquid = tile_liquid::Water;
+                            // Store new amount and type
+                            des.bits.flow_size = new_amount;
+                            des.bits.liquid_type = new_liquid;
+                            // Compute temperature
+                            if (!old_amount)
+                                old_liquid = tile_liquid::Water;
+                            if (!new_amount)
+                                new_liquid = tile_liquid::Water;
+                            if (old_liquid != new_liquid)
+                            {
+                                if (new_liquid == tile_liquid::Water)
+                                {
+                                    block->setTemp1At(current,10015);
+                                    block->setTemp2At(current,10015);
+                                }
+                                else
+                                {
+                                    block->setTemp1At(current,12000);
+                                    block->setTemp2At(current,12000);
+                                }
+                            }
+                            // mark the tile passable or impassable like the game does
+                            des.bits.flow_forbid = (new_liquid == tile_liquid::Magma || new_amount > 3);
+                            block->setDesignationAt(current,des);
+                            // request flow engine updates
+                            block->enableBlockUpdates(new_amount != old_amount, new_liquid != old_liquid);
                         }
-                        else
+                        if (cur_mode.permaflow != PF_KEEP && raw_block)
                         {
-                            mcache.setTemp1At(current,12000);
-                            mcache.setTemp2At(current,12000);
+                            auto &flow = raw_block->liquid_flow[x][y];
+                            flow.bits.perm_flow_dir = permaflow_id[cur_mode.permaflow];
+                            flow.bits.temp_flow_timer = 0;
                         }
+                        updated = true;
+                        break;
                     }
-                    // mark the tile passable or impassable like the game does
-                    des.bits.flow_forbid = (new_liquid == tile_liquid::Magma || new_amount > 3);
-                    mcache.setDesignationAt(current,des);
-                    // request flow engine updates
-                    block->enableBlockUpdates(new_amount != old_amount, new_liquid != old_liquid);
-                }
-                if (cur_mode.permaflow != PF_KEEP && raw_block)
-                {
-                    auto &flow = raw_block->liquid_flow[current.x&15][current.y&15];
-                    flow.bits.perm_flow_dir = permaflow_id[cur_mode.permaflow];
-                    flow.bits.temp_flow_timer = 0;
                 }
-                seen_blocks.insert(block);
-                iter++;
             }
-            set <Block *>::iterator biter = seen_blocks.begin();
-            while (biter != seen_blocks.end())
+        }
+
+        if (!updated)
+            continue;
+
+        if (cur_mode.paint == P_RIVER_SOURCE)
+        {
+            block->enableBlockUpdates(true);
+            continue;
+        }
+        if (cur_mode.paint != P_MAGMA && cur_mode.paint != P_WATER && cur_mode.paint != P_FLOW_BITS)
+            continue;
+
+        switch (cur_mode.flowmode)
+        {
+        case M_INC:
+            block->enableBlockUpdates(true);
+            break;
+        case M_DEC:
+            if (raw_block)
             {
-                switch (cur_mode.flowmode)
-                {
-                case M_INC:
-                    (*biter)->enableBlockUpdates(true);
-                    break;
-                case M_DEC:
-                    if (auto block = (*biter)->getRaw())
-                    {
-                        block->flags.clear(block_flags::update_liquid);
-                        block->flags.clear(block_flags::update_liquid_twice);
-                    }
-                    break;
-                case M_KEEP:
-                    {
-                        auto block = (*biter)->getRaw();
-                        out << "flow bit 1 = " << block->flags.is_set(block_flags::update_liquid) << endl; 
-                        out << "flow bit 2 = " << block->flags.is_set(block_flags::update_liquid_twice) << endl;
-                    }
-                }
-                biter ++;
+                raw_block->flags.clear(block_flags::update_liquid);
+                raw_block->flags.clear(block_flags::update_liquid_twice);
             }
             break;
+        case M_KEEP:
+            out << "flow bit 1 = " << raw_block->flags.is_set(block_flags::update_liquid) << endl;
+            out << "flow bit 2 = " << raw_block->flags.is_set(block_flags::update_liquid_twice) << endl;
         }
     }
 
@@ -2,7 +2,7 @@ local _ENV = mkmodule('plugins.building-hacks')
 --[[
 	from native:
 		addBuilding(custom type,impassible fix (bool), consumed power, produced power, list of connection points, 
-		update skip(0/nil to disable),table of frames,frame to tick ratio (-1 for machine control))
+		update skip(0/nil to disable),table of frames,frame to tick ratio (-1 for machine control),batch updates (bool))
 	from here:
 		registerBuilding{
 			name -- custom workshop id e.g. SOAPMAKER << required!
@@ -11,6 +11,7 @@ local _ENV = mkmodule('plugins.building-hacks')
 			produce -- how much machine power is produced
 			gears -- a table or {x=?,y=?} of connection points for machines
 			action -- a table of number (how much ticks to skip) and a function which gets called on shop update
+				batch -- if true, the function gets called once per frame with a list of all due shops of this type
 			animate -- a table of
 				frames -- a table of 
 					tables of 4 numbers (tile,fore,back,bright) OR
@@ -21,11 +22,14 @@ local _ENV = mkmodule('plugins.building-hacks')
 			}
 ]]
 _registeredStuff={}
+_registeredBatch={}
 local function unregall(state)
     if state==SC_WORLD_UNLOADED then
         onUpdateAction._library=nil
+        onUpdateActionBatch._library=nil
         dfhack.onStateChange.building_hacks= nil
         _registeredStuff={}
+        _registeredBatch={}
     end
 end
 local function onUpdateLocal(workshop)
@@ -34,6 +38,24 @@ local function onUpdateLocal(workshop)
 		f(workshop)
 	end
 end
+local function onUpdateBatchLocal(workshops)
+	local order={}
+	local lists={}
+	for k,v in ipairs(workshops) do
+		local shopId=v:getCustomType()
+		if not lists[shopId] then
+			lists[shopId]={}
+			table.insert(order,shopId)
+		end
+		table.insert(lists[shopId],v)
+	end
+	for k,shopId in ipairs(order) do
+		local f=_registeredBatch[shopId]
+		if f then
+			f(lists[shopId])
+		end
+	end
+end
 local function findCustomWorkshop(name)
 	local raws=df.global.world.raws.buildings.all
 	for k,v in ipairs(raws) do
@@ -42,9 +64,14 @@ local function findCustomWorkshop(name)
 		end
 	end
 end
-local function registerUpdateAction(shopId,callback)
-	_registeredStuff[shopId]=callback
-	onUpdateAction._library=onUpdateLocal
+local function registerUpdateAction(shopId,callback,batch)
+	if batch then
+		_registeredBatch[shopId]=callback
+		onUpdateActionBatch._library=onUpdateBatchLocal
+	else
+		_registeredStuff[shopId]=callback
+		onUpdateAction._library=onUpdateLocal
+	end
 	dfhack.onStateChange.building_hacks=unregall
 end
 local function generateFrame(tiles,w,h)
@@ -88,9 +115,11 @@ function registerBuilding(args)
 	local gears=args.gears or {}
 	local action=args.action --could be nil
 	local updateSkip=0
+	local batch=false
 	if action~=nil then
 		updateSkip=action[1]
-		registerUpdateAction(shop_id,action[2])
+		batch=action.batch and true or false
+		registerUpdateAction(shop_id,action[2],batch)
 	end
 	local animate=args.animate
 	local frameLength=1
@@ -103,7 +132,7 @@ function registerBuilding(args)
 		frames=processFrames(shop_def,animate.frames)
 	end
 	
-	addBuilding(shop_id,fix_impassible,consume,produce,gears,updateSkip,frames,frameLength)
+	addBuilding(shop_id,fix_impassible,consume,produce,gears,updateSkip,frames,frameLength,batch)
 end
 
 return _ENV
\ No newline at end of file
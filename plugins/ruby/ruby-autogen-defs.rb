@@ -538,6 +538,92 @@ module DFHack
             end
 
             include Enumerable
+            def _elemsize ; 4 ; end
+
+            # read the whole vector buffer at once and unpack it, for vectors
+            # of pointers or plain numbers ; nil for other element types
+            def _bulk_raw
+                fmt = case @_tg
+                      when Pointer; 'L' if _elemsize == 4
+                      when Number
+                          if @_tg._bits == 8*_elemsize
+                              f = { 1 => 'c', 2 => 's', 4 => 'l' }[_elemsize]
+                              @_tg._signed ? f : f.upcase
+                          end
+                      end
+                DFHack.memory_vector_raw(@_memaddr).unpack(fmt + '*') if fmt
+            end
+
+            # iterate with a single native call instead of one per element
+            def each
+                raw = _bulk_raw
+                if not raw
+                    (0...length).each { |i| yield self[i] }
+                elsif @_tg.kind_of?(Pointer)
+                    tg = @_tg._tg
+                    raw.each { |p| yield((p == 0) ? nil : tg ? tg._at(p)._get : p) }
+                elsif enum = @_tg._enum
+                    raw.each { |v| yield enum.sym(v) }
+                else
+                    raw.each { |v| yield v }
+                end
+                self
+            end
+
+            # read a few fields from every object of a vector of pointers,
+            # with a single native call for the whole vector
+            # returns one array of values per element (nil for NULL pointers)
+            # ex: world.units.active._project(:id, :civ_id, 'pos.x')
+            def _project(*names)
+                raise 'can only project vectors of pointers' if not @_tg.kind_of?(Pointer) or not @_tg._tg
+                tg = @_tg._tg
+                cls = tg.kind_of?(Global) ? DFHack.const_get(tg._glob) : tg.class
+
+                layout = []
+                fmt = ''
+                enums = []
+                names.each { |n|
+                    off = 0
+                    c = cls
+                    fld = nil
+                    n.to_s.split('.').each { |fn|
+                        raise "cannot project #{n}" if not c.respond_to?(:_fields_ancestors)
+                        f = c._fields_ancestors.find { |ff| ff[0].to_s == fn }
+                        raise "no field #{fn} in #{c}" if not f
+                        off += f[1]
+                        fld = f[2]
+                        c = fld.kind_of?(Global) ? DFHack.const_get(fld._glob) : fld.class
+                    }
+                    case fld
+                    when Number
+                        code = { 8 => 'c', 16 => 's', 32 => 'l', 64 => 'q' }[fld._bits]
+                        layout << off << fld._bits/8
+                        fmt << (fld._signed ? code : code.upcase)
+                        enums << fld._enum
+                    when Float
+                        layout << off << 4
+                        fmt << 'f'
+                        enums << nil
+                    when Double
+                        layout << off << 8
+                        fmt << 'd'
+                        enums << nil
+                    else
+                        raise "cannot project #{n}: unsupported field type"
+                    end
+                }
+
+                ptrs = _bulk_raw
+                raw = DFHack.memory_read_fields(ptrs.pack('L*'), layout.pack('L*'))
+                vals = raw.unpack(fmt * ptrs.length)
+                ptrs.each_with_index.map { |p, i|
+                    next if p == 0
+                    row = vals[i*names.length, names.length]
+                    enums.each_with_index { |e, j| row[j] = e.sym(row[j]) if e }
+                    row
+                }
+            end
+
             # do a binary search in an ordered vector for a specific target attribute
             # ex: world.history.figures.binsearch(unit.hist_figure_id)
             def binsearch(target, field=:id)
@@ -558,6 +644,7 @@ module DFHack
             end
         end
         class StlVector16 < StlVector32
+            def _elemsize ; 2 ; end
             def length
                 DFHack.memory_vector16_length(@_memaddr)
             end
@@ -572,6 +659,7 @@ module DFHack
             end
         end
         class StlVector8 < StlVector32
+            def _elemsize ; 1 ; end
             def length
                 DFHack.memory_vector8_length(@_memaddr)
             end
@@ -639,6 +639,43 @@ static VALUE rb_dfmemory_read_double(VALUE self, VALUE addr)
     return rb_float_new(*(double*)rb_num2ulong(addr));
 }
 
+// bulk reading: the same fields of many objects in one call
+// objs is a packed string of object addresses ('L*'), layout a packed string
+// of (offset, size) pairs ('L*'); returns the field bytes of each object in
+// turn, in layout order, with zeroes for NULL objects
+static VALUE rb_dfmemory_read_fields(VALUE self, VALUE objs, VALUE layout)
+{
+    int nobjs = FIX2INT(rb_funcall(objs, rb_intern("length"), 0)) / 4;
+    int nfields = FIX2INT(rb_funcall(layout, rb_intern("length"), 0)) / 8;
+    uint32_t *objptr = (uint32_t*)rb_string_value_ptr(&objs);
+    uint32_t *fieldptr = (uint32_t*)rb_string_value_ptr(&layout);
+
+    size_t rowsize = 0;
+    for (int f = 0; f < nfields; f++)
+        rowsize += fieldptr[2*f+1];
+
+    std::vector<char> buf(nobjs * rowsize);
+    if (buf.empty())
+        return rb_str_new("", 0);
+
+    char *out = &buf[0];
+    for (int o = 0; o < nobjs; o++)
+    {
+        char *base = (char*)objptr[o];
+        for (int f = 0; f < nfields; f++)
+        {
+            uint32_t size = fieldptr[2*f+1];
+            if (base)
+                memcpy(out, base + fieldptr[2*f], size);
+            else
+                memset(out, 0, size);
+            out += size;
+        }
+    }
+
+    return rb_str_new(&buf[0], buf.size());
+}
+
 
 // memory writing (buffer)
 static VALUE rb_dfmemory_write(VALUE self, VALUE addr, VALUE raw)
@@ -813,6 +850,14 @@ static VALUE rb_dfmemory_vec_init(VALUE self, VALUE addr)
     new((void*)rb_num2ulong(addr)) stl::vector<uint8_t>();
     return Qtrue;
 }
+// whole buffer of a vector, as a string (for bulk unpacking)
+static VALUE rb_dfmemory_vec_raw(VALUE self, VALUE addr)
+{
+    stl::vector<uint8_t> *v = (stl::vector<uint8_t>*)rb_num2ulong(addr);
+    if (v->empty())
+        return rb_str_new("", 0);
+    return rb_str_new((char*)&(*v)[0], v->size());
+}
 // vector<uint8>
 static VALUE rb_dfmemory_vec8_length(VALUE self, VALUE addr)
 {
@@ -1081,6 +1126,7 @@ static void ruby_bind_dfhack(void) {
     rb_define_singleton_method(rb_cDFHack, "memory_read_int32", RUBY_METHOD_FUNC(rb_dfmemory_read_int32), 1);
     rb_define_singleton_method(rb_cDFHack, "memory_read_float", RUBY_METHOD_FUNC(rb_dfmemory_read_float), 1);
     rb_define_singleton_method(rb_cDFHack, "memory_read_double", RUBY_METHOD_FUNC(rb_dfmemory_read_double), 1);
+    rb_define_singleton_method(rb_cDFHack, "memory_read_fields", RUBY_METHOD_FUNC(rb_dfmemory_read_fields), 2);
 
     rb_define_singleton_method(rb_cDFHack, "memory_write", RUBY_METHOD_FUNC(rb_dfmemory_write), 2);
     rb_define_singleton_method(rb_cDFHack, "memory_write_int8",  RUBY_METHOD_FUNC(rb_dfmemory_write_int8),  2);
@@ -1099,6 +1145,7 @@ static void ruby_bind_dfhack(void) {
     rb_define_singleton_method(rb_cDFHack, "memory_vector_new",  RUBY_METHOD_FUNC(rb_dfmemory_vec_new), 0);
     rb_define_singleton_method(rb_cDFHack, "memory_vector_delete",  RUBY_METHOD_FUNC(rb_dfmemory_vec_delete), 1);
     rb_define_singleton_method(rb_cDFHack, "memory_vector_init",  RUBY_METHOD_FUNC(rb_dfmemory_vec_init), 1);
+    rb_define_singleton_method(rb_cDFHack, "memory_vector_raw",  RUBY_METHOD_FUNC(rb_dfmemory_vec_raw), 1);
     rb_define_singleton_method(rb_cDFHack, "memory_vector8_length",  RUBY_METHOD_FUNC(rb_dfmemory_vec8_length), 1);
     rb_define_singleton_method(rb_cDFHack, "memory_vector8_ptrat",   RUBY_METHOD_FUNC(rb_dfmemory_vec8_ptrat), 2);
     rb_define_singleton_method(rb_cDFHack, "memory_vector8_insertat",  RUBY_METHOD_FUNC(rb_dfmemory_vec8_insertat), 3);
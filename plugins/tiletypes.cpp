@@ -715,7 +715,8 @@ command_result executePaintJob(color_ostream &out)
 
     DFHack::DFCoord cursor(x,y,z);
     MapExtras::MapCache map;
-    coord_vec all_tiles = brush->points(map, cursor);
+    span_vec all_spans = brush->spans(map, cursor);
+    int total = countTiles(all_spans);
     out.print("working...\n");
 
     // Force the game to recompute its walkability cache
@@ -723,127 +724,139 @@ command_result executePaintJob(color_ostream &out)
 
     int failures = 0;
 
-    for (coord_vec::iterator iter = all_tiles.begin(); iter != all_tiles.end(); ++iter)
+    for (span_vec::iterator iter = all_spans.begin(); iter != all_spans.end(); ++iter)
     {
-        MapExtras::Block *blk = map.BlockAtTile(*iter);
+        MapExtras::Block *blk = map.BlockAt(iter->block);
         if (!blk)
             continue;
 
-        df::tiletype source = map.tiletypeAt(*iter);
-        df::tile_designation des = map.designationAt(*iter);
-        df::tile_occupancy occ = map.occupancyAt(*iter);
-
-        // Stone painting operates on the base layer
-        if (paint.stone_material >= 0)
-            source = blk->baseTiletypeAt(*iter);
-
-        t_matpair basemat = blk->baseMaterialAt(*iter);
-
-        if (!filter.matches(source, des, basemat))
-        {
-            continue;
-        }
-
-        df::tiletype_shape shape = paint.shape;
-        if (shape == tiletype_shape::NONE)
-        {
-            shape = tileShape(source);
-        }
-
-        df::tiletype_material material = paint.material;
-        if (material == tiletype_material::NONE)
-        {
-            material = tileMaterial(source);
-        }
-
-        df::tiletype_special special = paint.special;
-        if (special == tiletype_special::NONE)
-        {
-            special = tileSpecial(source);
-        }
-        df::tiletype_variant variant = paint.variant;
-        /*
-         * FIXME: variant should be:
-         * 1. If user variant:
-         * 2.   If user variant \belongs target variants
-         * 3.     use user variant
-         * 4.   Else
-         * 5.     use variant 0
-         * 6. If the source variant \belongs target variants
-         * 7    use source variant
-         * 8  ElseIf num target shape/material variants > 1
-         * 9.   pick one randomly
-         * 10.Else
-         * 11.  use variant 0
-         *
-         * The following variant check has been disabled because it's severely limiting
-         * the usefullness of the tool.
-         */
-        /*
-        if (variant == tiletype_variant::NONE)
-        {
-            variant = tileVariant(source);
-        }
-        */
-        // Remove direction from directionless tiles
-        DFHack::TileDirection direction = tileDirection(source);
-        if (shape != tiletype_shape::WALL)
-        {
-            direction.whole = 0;
-        }
-
-        df::tiletype type = DFHack::findTileType(shape, material, variant, special, direction);
-        // hack for empty space
-        if (shape == tiletype_shape::EMPTY && material == tiletype_material::AIR && variant == tiletype_variant::VAR_1 && special == tiletype_special::NORMAL && direction.whole == 0)
-        {
-            type = tiletype::OpenSpace;
-        }
-        // make sure it's not invalid
-        if(type != tiletype::Void)
+        for (int y = 0; y < 16; y++)
         {
-            if (paint.stone_material >= 0)
+            uint16_t row = iter->mask.bits[y];
+            for (int x = 0; row && x < 16; x++)
             {
-//                if (!blk->setStoneAt(*iter, type, paint.stone_material, true, true))
-                    failures++;
+                if (!(row & (1 << x)))
+                    continue;
+                row &= ~(1 << x);
+                df::coord2d pos(x, y);
+
+                df::tiletype source = blk->tiletypeAt(pos);
+                df::tile_designation des = blk->DesignationAt(pos);
+                df::tile_occupancy occ = blk->OccupancyAt(pos);
+
+                // Stone painting operates on the base layer
+                if (paint.stone_material >= 0)
+                    source = blk->baseTiletypeAt(pos);
+
+                t_matpair basemat = blk->baseMaterialAt(pos);
+
+                if (!filter.matches(source, des, basemat))
+                {
+                    continue;
+                }
+
+                df::tiletype_shape shape = paint.shape;
+                if (shape == tiletype_shape::NONE)
+                {
+                    shape = tileShape(source);
+                }
+
+                df::tiletype_material material = paint.material;
+                if (material == tiletype_material::NONE)
+                {
+                    material = tileMaterial(source);
+                }
+
+                df::tiletype_special special = paint.special;
+                if (special == tiletype_special::NONE)
+                {
+                    special = tileSpecial(source);
+                }
+                df::tiletype_variant variant = paint.variant;
+                /*
+                 * FIXME: variant should be:
+                 * 1. If user variant:
+                 * 2.   If user variant \belongs target variants
+                 * 3.     use user variant
+                 * 4.   Else
+                 * 5.     use variant 0
+                 * 6. If the source variant \belongs target variants
+                 * 7    use source variant
+                 * 8  ElseIf num target shape/material variants > 1
+                 * 9.   pick one randomly
+                 * 10.Else
+                 * 11.  use variant 0
+                 *
+                 * The following variant check has been disabled because it's severely limiting
+                 * the usefullness of the tool.
+                 */
+                /*
+                if (variant == tiletype_variant::NONE)
+                {
+                    variant = tileVariant(source);
+                }
+                */
+                // Remove direction from directionless tiles
+                DFHack::TileDirection direction = tileDirection(source);
+                if (shape != tiletype_shape::WALL)
+                {
+                    direction.whole = 0;
+                }
+
+                df::tiletype type = DFHack::findTileType(shape, material, variant, special, direction);
+                // hack for empty space
+                if (shape == tiletype_shape::EMPTY && material == tiletype_material::AIR && variant == tiletype_variant::VAR_1 && special == tiletype_special::NORMAL && direction.whole == 0)
+                {
+                    type = tiletype::OpenSpace;
+                }
+                // make sure it's not invalid
+                if(type != tiletype::Void)
+                {
+                    if (paint.stone_material >= 0)
+                    {
+//                        if (!blk->setStoneAt(pos, type, paint.stone_material, true, true))
+                            failures++;
+                    }
+                    else
+                        blk->setTiletypeAt(pos, type);
+                }
+
+                if (paint.hidden > -1)
+                {
+                    des.bits.hidden = paint.hidden;
+                }
+
+                if (paint.light > -1)
+                {
+                    des.bits.light = paint.light;
+                }
+
+                if (paint.subterranean > -1)
+                {
+                    des.bits.subterranean = paint.subterranean;
+                }
+
+                if (paint.skyview > -1)
+                {
+                    des.bits.outside = paint.skyview;
+                }
+
+                // Remove liquid from walls, etc
+                if (type != (df::tiletype)-1 && !DFHack::FlowPassable(type))
+                {
+                    occ.bits.water = 0;
+                    occ.bits.lava = 0;
+                }
+
+                blk->setDesignationAt(pos, des);
             }
-            else
-                map.setTiletypeAt(*iter, type);
-        }
-
-        if (paint.hidden > -1)
-        {
-            des.bits.hidden = paint.hidden;
         }
-
-        if (paint.light > -1)
-        {
-            des.bits.light = paint.light;
-        }
-
-        if (paint.subterranean > -1)
-        {
-            des.bits.subterranean = paint.subterranean;
-        }
-
-        if (paint.skyview > -1)
-        {
-            des.bits.outside = paint.skyview;
-        }
-
-        // Remove liquid from walls, etc
-        if (type != (df::tiletype)-1 && !DFHack::FlowPassable(type))
-        {
-            occ.bits.water = 0;
-            occ.bits.lava = 0;
-        }
-
-        map.setDesignationAt(*iter, des);
     }
 
     if (failures > 0)
-        out.printerr("Could not update %d tiles of %d.\n", failures, all_tiles.size());
+        out.printerr("Could not update %d tiles of %d.\n", failures, total);
     else
-        out.print("Processed %d tiles.\n", all_tiles.size());
+        out.print("Processed %d tiles.\n", total);
 
     if (map.WriteAll())
     {
@@ -404,6 +404,8 @@ public:
  ******************************/
 
 DFHACK_PLUGIN_IS_ENABLED(enabled);
+// Every 5 frames check the jobs for disappearance
+DFHACK_PLUGIN_UPDATE_CADENCE(update_cadence, 5, 0);
 
 static PersistentDataItem config;
 
@@ -671,11 +673,6 @@ DFhackCExport command_result plugin_onupdate(color_ostream &out)
     if (!enabled)
         return CR_OK;
 
-    // Every 5 frames check the jobs for disappearance
-    static unsigned cnt = 0;
-    if ((++cnt % 5) != 0)
-        return CR_OK;
-
     check_lost_jobs(out, world->frame_counter - last_tick_frame_count);
     last_tick_frame_count = world->frame_counter;
 